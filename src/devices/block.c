@@ -3,7 +3,9 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
+#include "threads/trace.h"
 
 /* A block device. */
 struct block
@@ -120,9 +122,16 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
+  uint64_t start = 0;
+
   check_sector (block, sector);
+  if (trace_enabled)
+    start = timer_cycles ();
   block->ops->read (block->aux, sector, buffer);
   block->read_cnt++;
+  if (trace_enabled)
+    trace_event (TRACE_BLOCK_READ, sector, block->type,
+                 timer_cycles () - start);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -133,10 +142,17 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
+  uint64_t start = 0;
+
   check_sector (block, sector);
   ASSERT (block->type != BLOCK_FOREIGN);
+  if (trace_enabled)
+    start = timer_cycles ();
   block->ops->write (block->aux, sector, buffer);
   block->write_cnt++;
+  if (trace_enabled)
+    trace_event (TRACE_BLOCK_WRITE, sector, block->type,
+                 timer_cycles () - start);
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -11,9 +11,6 @@
 #define PIT_PORT_CONTROL          0x43                /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -81,3 +78,61 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Configures channel 0 in mode 0, "interrupt on terminal count":
+   its output goes high, raising interrupt line 0, once after
+   COUNT PIT cycles, and then the channel stops interrupting
+   until it is configured again.  A COUNT of 0 is treated by the
+   PIT as 65536. */
+void
+pit_configure_oneshot (int channel, uint16_t count)
+{
+  enum intr_level old_level;
+
+  ASSERT (channel == 0);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30);
+  outb (PIT_PORT_COUNTER (channel), count);
+  outb (PIT_PORT_COUNTER (channel), count >> 8);
+  intr_set_level (old_level);
+}
+
+/* Returns the current value of CHANNEL's down-counter, latched
+   so that the low and high bytes are consistent. */
+uint16_t
+pit_read_count (int channel)
+{
+  enum intr_level old_level;
+  uint16_t count;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, channel << 6);
+  count = inb (PIT_PORT_COUNTER (channel));
+  count |= inb (PIT_PORT_COUNTER (channel)) << 8;
+  intr_set_level (old_level);
+
+  return count;
+}
+
+/* Returns the state of CHANNEL's output pin, read with the
+   8254 read-back command.  In mode 0 the output goes high at
+   terminal count, so this tells whether a one-shot programmed
+   with pit_configure_oneshot() has expired. */
+bool
+pit_output_high (int channel)
+{
+  enum intr_level old_level;
+  uint8_t status;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, 0xe0 | (2 << channel));
+  status = inb (PIT_PORT_COUNTER (channel));
+  intr_set_level (old_level);
+
+  return (status & 0x80) != 0;
+}
@@ -4,7 +4,14 @@
 #include "devices/kbd.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/profile.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
@@ -93,6 +100,7 @@ shutdown_power_off (void)
 #ifdef FILESYS
   filesys_done ();
 #endif
+  trace_dump ();
 
   print_stats ();
 
@@ -118,7 +126,13 @@ static void
 print_stats (void)
 {
   timer_print_stats ();
+  intr_print_stats ();
   thread_print_stats ();
+  lock_print_stats ();
+  palloc_print_stats ();
+  malloc_print_stats ();
+  kmem_print_stats ();
+  profile_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
 #endif
@@ -6,6 +6,7 @@
 #include "devices/pit.h"
 #include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "lib/kernel/list.h"
@@ -21,8 +22,53 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
-//true if list of sleeping threads is uninitialized
-bool b_initialized_sleeping_list = false;
+/* PIT cycles in one timer tick. */
+#define PIT_CYCLES_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* If false (default), the timer interrupts TIMER_FREQ times per
+   second at all times.
+   If true, the periodic tick is stopped while the idle thread
+   runs and the PIT is programmed to fire once at the next
+   sleeper's wake up time instead.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+//true while the PIT is in one-shot mode instead of the periodic tick, either
+//on behalf of the idle thread or for a sub-tick sleep
+static bool b_oneshot_armed;
+//PIT cycles of the current tick which had elapsed when the one-shot was armed
+static uint32_t ui32_oneshot_carry;
+//PIT cycles the one-shot was programmed with
+static uint32_t ui32_oneshot_count;
+
+/* Nanoseconds per second and per timer tick. */
+#define NS_PER_SEC 1000000000LL
+#define NS_PER_TICK (NS_PER_SEC / TIMER_FREQ)
+
+/* Timer ticks the TSC is measured over by timer_calibrate(). */
+#define TSC_CALIBRATION_TICKS (TIMER_FREQ / 10)
+
+/* TSC cycles per second, or 0 until timer_calibrate() has
+   measured it against the PIT. */
+static uint64_t tsc_hz;
+/* TSC value and timer_ns() value at the time of measurement. */
+static uint64_t tsc_base;
+static int64_t ns_base;
+
+/* Sub-tick sleeps shorter than this spin on the TSC, since
+   blocking and taking an interrupt would cost about as much. */
+#define HR_SPIN_NS 20000
+/* Shortest one-shot the PIT is programmed with for a sub-tick
+   sleeper whose wake up time is (almost) due. */
+#define HR_MIN_CYCLES 8
+
+/*threads in a sub-tick sleep, ordered by wake up time in nanoseconds*/
+//whole ticks are slept on the timing wheel first, so only threads with less
+//than about a tick left to sleep are here and the list stays short
+static struct list l_hr_sleeping;
+
+//true once the timing wheel of sleeping threads is initialized
+bool b_initialized_timer_wheel = false;
 
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
@@ -33,42 +79,72 @@ static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
-//looks in the list of sleeping threads and wakes up the threads
-
+//wakes up the threads whose wake up time has come, up to the current tick
 static void fu_check_sleeping(void);
-//comparison function for l_sleeping_threads
-static bool fu_compare(const struct list_elem *le_a,
-                       const struct list_elem *le_b, void *aux UNUSED);
-
-/*list which holds references to threads which are asleep*/
-/*orders the threads in increasing order of time when they have to be awaken*/
-struct list l_sleeping_threads;
-
-/*the structure which holds a list_elem*/
-/*it also holds a thread and the time when the thread has to be awaken*/
-struct wake_up
-{
-  //I need to store the list element by its value so that its
-  //shall be initialized
-  struct list_elem le;
-  struct thread *th;
-  int64_t wake_time;
-};
-
-//lock used by the timer_sleep function
-struct lock lock_timer_sleep;
-
+//returns the earliest wake up time of a sleeping thread, or I64_HORIZON if
+//no thread has to wake up before it
+static int64_t fu_next_wake_time(int64_t i64_horizon);
+//adds the ticks which passed since the one-shot was armed and stores the PIT
+//cycles elapsed in the current tick in UI32_PHASE
+static bool fu_timer_sync(uint32_t *ui32_phase);
+//programs the PIT for the next tick or sub-tick wake up time
+static void fu_timer_program(uint32_t ui32_phase);
+//blocks the current thread until tick I64_WAKE_TIME
+static void fu_sleep_until(int64_t i64_wake_time);
+//blocks the current thread until timer_ns() reaches I64_DEADLINE
+static void fu_sleep_until_ns(int64_t i64_deadline);
+//wakes up the sub-tick sleepers whose wake up time has come
+static void fu_check_hr_sleeping(void);
+static bool fu_compare_wake_ns(const struct list_elem *a,
+                               const struct list_elem *b,
+                               void *aux UNUSED);
+//files a sleeping thread in the timing wheel slot of its wake up time
+static void fu_wheel_insert(struct thread *t);
+//moves the threads of a slot of an outer level to inner levels
+static int fu_wheel_cascade(int i_level);
+
+/*hierarchical timing wheel holding the threads which are asleep*/
+/*level 0 has one slot per tick for the next WHEEL_ROOT_SIZE ticks; each of
+  the outer levels has slots covering as many ticks as the whole level
+  below it.  A thread is filed in O(1) by the distance to its wake up time
+  and its slot is found again from the wake up time itself.  Each time the
+  slot index of a level wraps around, the next slot of the level above is
+  emptied into the lower levels, so that every thread is moved at most
+  once per level before it wakes up.*/
+#define WHEEL_ROOT_BITS 8
+#define WHEEL_LEVEL_BITS 6
+#define WHEEL_ROOT_SIZE (1 << WHEEL_ROOT_BITS)
+#define WHEEL_LEVEL_SIZE (1 << WHEEL_LEVEL_BITS)
+#define WHEEL_LEVEL_CNT 5
+//farthest wake up time the wheel can hold, relative to the current tick
+#define WHEEL_MAX_DELTA ((1LL << (WHEEL_ROOT_BITS + \
+                                  (WHEEL_LEVEL_CNT - 1) * WHEEL_LEVEL_BITS)) - 1)
+
+static struct list wheel_root[WHEEL_ROOT_SIZE];
+static struct list wheel_levels[WHEEL_LEVEL_CNT - 1][WHEEL_LEVEL_SIZE];
+//next tick whose slot has not been processed yet
+static int64_t wheel_time;
+
+//returns the slot index of wake up time T in outer level I_LEVEL (from 1)
+#define m_wheel_index(T, I_LEVEL) \
+  ((int) ((T) >> (WHEEL_ROOT_BITS + ((I_LEVEL) - 1) * WHEEL_LEVEL_BITS)) \
+   & (WHEEL_LEVEL_SIZE - 1))
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void) 
 {
-  /*initialize list of sleeping threads*/
-  list_init(&l_sleeping_threads);
-  b_initialized_sleeping_list = true;
-  //initialize lock
-  lock_init(&lock_timer_sleep);
+  /*initialize the timing wheel of sleeping threads*/
+  int i, j;
+  for(i = 0; i < WHEEL_ROOT_SIZE; i++)
+    list_init(&wheel_root[i]);
+  for(i = 0; i < WHEEL_LEVEL_CNT - 1; i++)
+    for(j = 0; j < WHEEL_LEVEL_SIZE; j++)
+      list_init(&wheel_levels[i][j]);
+  wheel_time = ticks + 1;
+  b_initialized_timer_wheel = true;
+  list_init(&l_hr_sleeping);
 
   //TODO
   //I have no clue what these two do so it's safer to place the list
@@ -102,6 +178,25 @@ timer_calibrate (void)
       loops_per_tick |= test_bit;
 
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  /* Count TSC cycles over a few whole ticks.  A tick lasts
+     PIT_CYCLES_PER_TICK cycles of the PIT, which is slightly
+     off from 1 s / TIMER_FREQ. */
+  int64_t start = ticks;
+  while (ticks == start)
+    barrier ();
+  uint64_t tsc_start = timer_cycles ();
+  start = ticks;
+  while (ticks - start < TSC_CALIBRATION_TICKS)
+    barrier ();
+  uint64_t tsc_cnt = timer_cycles () - tsc_start;
+
+  enum intr_level old_level = intr_disable ();
+  ns_base = start * NS_PER_TICK;
+  tsc_base = tsc_start;
+  tsc_hz = tsc_cnt * PIT_HZ / (TSC_CALIBRATION_TICKS * PIT_CYCLES_PER_TICK);
+  intr_set_level (old_level);
+  printf ("TSC runs at %'"PRIu64" Hz.\n", tsc_hz);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -122,45 +217,82 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the CPU's time stamp counter. */
+uint64_t
+timer_cycles (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Returns the frequency of the TSC in Hz, or 0 before
+   timer_calibrate(). */
+uint64_t
+timer_cycles_per_sec (void)
+{
+  return tsc_hz;
+}
+
+/* Returns the number of nanoseconds since the OS booted, read
+   from the TSC.  Before timer_calibrate() this only has the
+   resolution of a timer tick. */
+int64_t
+timer_ns (void)
+{
+  if (tsc_hz == 0)
+    return timer_ticks () * NS_PER_TICK;
+
+  /* Split into whole seconds first so that the multiplication
+     cannot overflow. */
+  uint64_t tsc = timer_cycles () - tsc_base;
+  return ns_base + tsc / tsc_hz * NS_PER_SEC
+         + tsc % tsc_hz * NS_PER_SEC / tsc_hz;
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
    be turned on. */
 void
-timer_sleep (int64_t ticks) 
+timer_sleep (int64_t ticks_) 
 {
   ASSERT (intr_get_level () == INTR_ON);
 
-  //TODO remove
-  intr_disable();
-
-  //the thread asks to get the lock
-  //TODO
-  //lock_acquire(&lock_timer_sleep);
-
-  //creates a container holding a thread and the time this has to wake up
-  struct wake_up p_wu;
-  //TODO consider moving the element in the thread itself
+  enum intr_level old_level = intr_disable();
 
-  p_wu.th = thread_current();
   //the wake up time for the thread is the current time + the time the
   //thread has to sleep
-  //TODO what if there  is an interrupt between the calling og this function
-  //and the time I access timer_ticks()?
-  //if it is during the function call then I have nothing to do
-  //adding a field to thread won't change anything
-  p_wu.wake_time = timer_ticks() + ticks;
+  fu_sleep_until(ticks + ticks_);
+  intr_set_level(old_level);
+}
 
-  //adds a list element to the end of the list
-  list_insert_ordered(&l_sleeping_threads, &p_wu.le, &fu_compare, NULL);
+static void
+fu_sleep_until(int64_t i64_wake_time)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
 
-  //releases lock
-  //TODO
-  //lock_release(&lock_timer_sleep);
+  struct thread *t = thread_current();
+  t->wake_time = i64_wake_time;
+  t->b_sleeping = true;
+  fu_wheel_insert(t);
 
-  //TODO
-  //intr_disable();
   //I block the current thread
   thread_block();
-  intr_enable();
+}
+
+/* Wakes up thread T, which is sleeping in timer_sleep() or in a
+   sub-tick sleep, before its wake up time.  Returns false if T
+   is not sleeping.  Must be called with interrupts off. */
+bool
+timer_wake (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!t->b_sleeping)
+    return false;
+  list_remove (&t->le_sleep);
+  t->b_sleeping = false;
+  thread_unblock (t);
+  return true;
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -226,6 +358,67 @@ timer_ndelay (int64_t ns)
   real_time_delay (ns, 1000 * 1000 * 1000);
 }
 
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  In tickless mode, replaces the periodic tick by
+   a single interrupt at the earliest sleeper's wake up time or
+   real-time thread's release, or as close to it as the 16-bit
+   PIT counter allows. */
+void
+timer_idle_enter (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || b_oneshot_armed || !list_empty(&l_hr_sleeping))
+    return;
+
+  //the PIT counts down from PIT_CYCLES_PER_TICK in periodic mode
+  uint32_t ui32_carry = PIT_CYCLES_PER_TICK - pit_read_count(0);
+  if(ui32_carry >= PIT_CYCLES_PER_TICK)
+    return;
+
+  //fire exactly on a tick boundary, at most 65535 PIT cycles from now
+  int64_t i64_max_tick_cnt = (UINT16_MAX + ui32_carry) / PIT_CYCLES_PER_TICK;
+  int64_t i64_deadline = fu_next_wake_time(ticks + i64_max_tick_cnt);
+  //the throttled real-time threads are not in the wheel
+  int64_t i64_release = thread_edf_next_release();
+  if(i64_deadline > i64_release)
+    i64_deadline = i64_release;
+  //the advanced scheduler does its bookkeeping once per second, so the
+  //tick count must not jump over a second boundary
+  if(thread_mlfqs)
+  {
+    int64_t i64_next_second = (ticks / TIMER_FREQ + 1) * TIMER_FREQ;
+    if(i64_deadline > i64_next_second)
+      i64_deadline = i64_next_second;
+  }
+  //no point stopping the tick for the next one
+  int64_t i64_tick_cnt = i64_deadline - ticks;
+  if(i64_tick_cnt <= 1)
+    return;
+
+  ui32_oneshot_carry = ui32_carry;
+  ui32_oneshot_count = i64_tick_cnt * PIT_CYCLES_PER_TICK - ui32_carry;
+  b_oneshot_armed = true;
+  pit_configure_oneshot(0, ui32_oneshot_count);
+}
+
+/* Called by the scheduler, with interrupts off, when the idle
+   thread is switched out.  In tickless mode, accounts the ticks
+   that passed while the CPU was halted, releases the real-time
+   threads they made due and restarts the periodic tick. */
+void
+timer_idle_exit (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  uint32_t ui32_phase;
+  if (b_oneshot_armed && fu_timer_sync(&ui32_phase))
+  {
+    fu_timer_program(ui32_phase);
+    thread_edf_release();
+  }
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) 
@@ -235,12 +428,39 @@ timer_print_stats (void)
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
 {
-  ticks++;
+  int64_t i64_old_ticks = ticks;
+  uint32_t ui32_phase = 0;
+  bool b_reprogram = false;
+
+  //in one-shot mode, this interrupt may stand for several ticks, or for none
+  //at all if it fired for a sub-tick sleeper
+  //with the output still low, it is a periodic tick which was already pending
+  //when the one-shot was armed
+  if(b_oneshot_armed && pit_output_high(0))
+  {
+    uint32_t ui32_total = ui32_oneshot_carry + ui32_oneshot_count;
+    ticks += ui32_total / PIT_CYCLES_PER_TICK;
+    ui32_phase = ui32_total % PIT_CYCLES_PER_TICK;
+    b_reprogram = true;
+  }
+  else
+    ticks++;
+
+  profile_sample(args);
+
+  if(b_initialized_timer_wheel)
+    fu_check_hr_sleeping();
+  //the next sub-tick sleeper may have to wake up before the next tick
+  if(b_reprogram || (!b_oneshot_armed && !list_empty(&l_hr_sleeping)))
+    fu_timer_program(ui32_phase);
+
+  if(ticks == i64_old_ticks)
+    return;
 
   //checks if any thread can be waken up
-  if(b_initialized_sleeping_list)
+  if(b_initialized_timer_wheel)
   {
     fu_check_sleeping();
   }
@@ -294,7 +514,14 @@ real_time_sleep (int64_t num, int32_t denom)
   int64_t ticks = num * TIMER_FREQ / denom;
 
   ASSERT (intr_get_level () == INTR_ON);
-  if (ticks > 0)
+  if (tsc_hz != 0)
+    {
+      /* Once the TSC is calibrated, block until the deadline even
+         for less than a tick. */
+      ASSERT (NS_PER_SEC % denom == 0);
+      fu_sleep_until_ns (timer_ns () + num * (NS_PER_SEC / denom));
+    }
+  else if (ticks > 0)
     {
       /* We're waiting for at least one full timer tick.  Use
          timer_sleep() because it will yield the CPU to other
@@ -319,55 +546,270 @@ real_time_delay (int64_t num, int32_t denom)
   busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000)); 
 }
 
+//processes the slot of every tick up to the current one
+//(in tickless mode several ticks may have passed since the last call)
 static void
 fu_check_sleeping(void)
 {
-  while(!list_empty(&l_sleeping_threads))
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  while(wheel_time <= ticks)
   {
-    //checks if the head of the list can be awaken
-    struct wake_up *wu = list_entry(list_front(&l_sleeping_threads),
-                                    struct wake_up, le);
-
-    //check the validity of the structure extracted
-    ASSERT(wu != NULL && wu->th != NULL);
-    //is the wake up time is before the current time or now
-    if(wu->wake_time <= timer_ticks())
+    int i_index = wheel_time & (WHEEL_ROOT_SIZE - 1);
+    int i_level;
+
+    //when level 0 wraps around, refill it from the next slot of level 1,
+    //and so on outwards for every level that wraps around as well
+    if(i_index == 0)
+      for(i_level = 1;
+          i_level < WHEEL_LEVEL_CNT && fu_wheel_cascade(i_level) == 0;
+          i_level++)
+        continue;
+
+    struct list *l_slot = &wheel_root[i_index];
+    while(!list_empty(l_slot))
     {
-      //I remove the first element, but I don't need to store the pointer
-      list_pop_front(&l_sleeping_threads);
-      //change the status of the thread which was the front of the list
-      thread_unblock(wu->th);
-
-      //TODO: free the memory
-      //I free the list element and the structure containing it from memory
-      /*
-      intr_enable();
-      free(wu);
-      intr_disable();
-      */
+      struct thread *t = list_entry(list_pop_front(l_slot),
+                                    struct thread, le_sleep);
+      //a wake up time too far for the wheel was filed at its farthest slot
+      if(t->wake_time > wheel_time)
+      {
+        fu_wheel_insert(t);
+        continue;
+      }
+      t->b_sleeping = false;
+      //change the status of the thread which was in the slot
+      thread_unblock(t);
     }
-    else
+    wheel_time++;
+  }
+}
+
+//files T in the slot of its wake up time, in the innermost level which
+//reaches that far
+static void
+fu_wheel_insert(struct thread *t)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(t != NULL);
+
+  int64_t i64_expires = t->wake_time;
+  int64_t i64_delta = i64_expires - wheel_time;
+  struct list *l_slot;
+
+  if(i64_delta < 0)
+  {
+    //already due: wake up on the next tick processed
+    l_slot = &wheel_root[wheel_time & (WHEEL_ROOT_SIZE - 1)];
+  }
+  else if(i64_delta < WHEEL_ROOT_SIZE)
+  {
+    l_slot = &wheel_root[i64_expires & (WHEEL_ROOT_SIZE - 1)];
+  }
+  else
+  {
+    if(i64_delta > WHEEL_MAX_DELTA)
     {
-      return;
+      i64_delta = WHEEL_MAX_DELTA;
+      i64_expires = wheel_time + WHEEL_MAX_DELTA;
     }
+
+    int i_level = 1;
+    while(i_level < WHEEL_LEVEL_CNT - 1 &&
+          i64_delta >= 1LL << (WHEEL_ROOT_BITS + i_level * WHEEL_LEVEL_BITS))
+      i_level++;
+    l_slot = &wheel_levels[i_level - 1][m_wheel_index(i64_expires, i_level)];
+  }
+
+  list_push_back(l_slot, &t->le_sleep);
+}
+
+//empties the slot of outer level I_LEVEL which covers the ticks now coming
+//into range of the level below, refiling its threads
+//returns the index of that slot, which is 0 when the level wrapped around
+static int
+fu_wheel_cascade(int i_level)
+{
+  int i_index = m_wheel_index(wheel_time, i_level);
+  struct list *l_slot = &wheel_levels[i_level - 1][i_index];
+  struct list l_moved;
+
+  //the slot is emptied first: a thread may be refiled in the same slot
+  list_init(&l_moved);
+  while(!list_empty(l_slot))
+    list_push_back(&l_moved, list_pop_front(l_slot));
+  while(!list_empty(&l_moved))
+    fu_wheel_insert(list_entry(list_pop_front(&l_moved),
+                               struct thread, le_sleep));
+  return i_index;
+}
+
+//returns the earliest wake up time of a sleeping thread, looking no further
+//than I64_HORIZON
+//threads beyond the next wrap around of level 0 are not looked at, since the
+//wheel has to cascade at that tick anyway
+static int64_t
+fu_next_wake_time(int64_t i64_horizon)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if(!b_initialized_timer_wheel)
+    return i64_horizon;
+
+  int64_t i64_time;
+  for(i64_time = wheel_time; i64_time < i64_horizon; i64_time++)
+  {
+    int i_index = i64_time & (WHEEL_ROOT_SIZE - 1);
+    if(i_index == 0)
+      return i64_time;
+    if(!list_empty(&wheel_root[i_index]))
+      return i64_time;
   }
-  return;
+  return i64_horizon;
 }
 
-//comparison function for sleeping threads
+//brings the tick count up to date with the one-shot and stores in UI32_PHASE
+//the PIT cycles elapsed since the last tick boundary
+//returns false if the one-shot expired but its interrupt is still pending, in
+//which case the interrupt handler takes care of it
+//the caller must reprogram the PIT with fu_timer_program() afterwards
 static bool
-fu_compare(const struct list_elem *le_a, const struct list_elem *le_b, void *aux UNUSED)
-{
-  //checks if the elements it are not null
-  ASSERT(le_a != NULL);
-  ASSERT(le_b != NULL);
-  //checks its final argument does not mean anything
-  ASSERT(aux == NULL);
-  //obtain the struct which encompasses the element a and b
-  struct wake_up *p_wu_a = list_entry(le_a, struct wake_up, le);
-  struct wake_up *p_wu_b = list_entry(le_b, struct wake_up, le);
-
-  //returns true when the time element a has to be waken up is larger so the
-  //two elements have to be swaped
-  return (p_wu_a->wake_time < p_wu_b->wake_time);
+fu_timer_sync(uint32_t *ui32_phase)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if(!b_oneshot_armed)
+  {
+    //the PIT counts down from PIT_CYCLES_PER_TICK in periodic mode
+    uint32_t ui32_elapsed = PIT_CYCLES_PER_TICK - pit_read_count(0);
+    *ui32_phase = ui32_elapsed < PIT_CYCLES_PER_TICK ? ui32_elapsed : 0;
+    return true;
+  }
+
+  uint16_t ui16_count;
+  if(pit_output_high(0) || (ui16_count = pit_read_count(0)) == 0)
+    return false;
+
+  uint32_t ui32_total = ui32_oneshot_carry + ui32_oneshot_count - ui16_count;
+  ticks += ui32_total / PIT_CYCLES_PER_TICK;
+  *ui32_phase = ui32_total % PIT_CYCLES_PER_TICK;
+  return true;
+}
+
+//programs the PIT to interrupt at the wake up time of the first sub-tick
+//sleeper if it comes before the next tick boundary, otherwise at that
+//boundary, and goes back to the periodic tick when a boundary is reached
+//UI32_PHASE is the number of PIT cycles elapsed in the current tick
+static void
+fu_timer_program(uint32_t ui32_phase)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(ui32_phase < PIT_CYCLES_PER_TICK);
+
+  uint32_t ui32_count = PIT_CYCLES_PER_TICK - ui32_phase;
+
+  if(!list_empty(&l_hr_sleeping))
+  {
+    struct thread *t = list_entry(list_front(&l_hr_sleeping),
+                                  struct thread, le_sleep);
+    int64_t i64_left = t->wake_ns - timer_ns();
+    if(i64_left < NS_PER_TICK)
+    {
+      int64_t i64_cycles = i64_left * PIT_HZ / NS_PER_SEC;
+      if(i64_cycles < HR_MIN_CYCLES)
+        i64_cycles = HR_MIN_CYCLES;
+      if(i64_cycles < ui32_count)
+        ui32_count = i64_cycles;
+    }
+  }
+
+  if(ui32_count == PIT_CYCLES_PER_TICK)
+  {
+    //on a tick boundary with nothing to wake up in between
+    if(b_oneshot_armed)
+    {
+      b_oneshot_armed = false;
+      pit_configure_channel(0, 2, TIMER_FREQ);
+    }
+    return;
+  }
+
+  ui32_oneshot_carry = ui32_phase;
+  ui32_oneshot_count = ui32_count;
+  b_oneshot_armed = true;
+  pit_configure_oneshot(0, ui32_oneshot_count);
+}
+
+//sleeps the whole ticks up to I64_DEADLINE on the timing wheel, then blocks
+//for the rest with the PIT in one-shot mode
+static void
+fu_sleep_until_ns(int64_t i64_deadline)
+{
+  int64_t i64_tick_cnt = (i64_deadline - timer_ns()) / NS_PER_TICK;
+  if(i64_tick_cnt > 0)
+    timer_sleep(i64_tick_cnt);
+
+  int64_t i64_left = i64_deadline - timer_ns();
+  if(i64_left <= 0)
+    return;
+  if(i64_left < HR_SPIN_NS)
+  {
+    while(timer_ns() < i64_deadline)
+      barrier();
+    return;
+  }
+
+  enum intr_level old_level = intr_disable();
+
+  struct thread *t = thread_current();
+  t->wake_ns = i64_deadline;
+  t->b_sleeping = true;
+  list_insert_ordered(&l_hr_sleeping, &t->le_sleep, fu_compare_wake_ns, NULL);
+
+  uint32_t ui32_phase;
+  if(fu_timer_sync(&ui32_phase))
+    fu_timer_program(ui32_phase);
+
+  thread_block();
+  intr_set_level(old_level);
+}
+
+//wakes up the sub-tick sleepers whose wake up time has passed
+static void
+fu_check_hr_sleeping(void)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if(list_empty(&l_hr_sleeping))
+    return;
+
+  int64_t i64_now = timer_ns();
+  bool b_woken = false;
+  while(!list_empty(&l_hr_sleeping))
+  {
+    struct thread *t = list_entry(list_front(&l_hr_sleeping),
+                                  struct thread, le_sleep);
+    if(t->wake_ns > i64_now)
+      break;
+    list_pop_front(&l_hr_sleeping);
+    t->b_sleeping = false;
+    thread_unblock(t);
+    b_woken = true;
+  }
+
+  //thread_unblock() does not preempt, and this interrupt may not even be a
+  //tick, so a woken sleeper which outranks the running thread would wait
+  //for the end of its time slice; yield on return from the interrupt instead
+  if(b_woken)
+    fu_necessary_to_yield();
+}
+
+//orders sub-tick sleepers by wake up time
+static bool
+fu_compare_wake_ns(const struct list_elem *a,
+                   const struct list_elem *b,
+                   void *aux UNUSED)
+{
+  return list_entry(a, struct thread, le_sleep)->wake_ns
+         < list_entry(b, struct thread, le_sleep)->wake_ns;
 }
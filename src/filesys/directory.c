@@ -4,7 +4,7 @@
 #include <list.h>
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* A directory. */
 struct dir 
@@ -21,6 +21,16 @@ struct dir_entry
     bool in_use;                        /* In use or free? */
   };
 
+/* Cache of open directories. */
+static struct kmem_cache dir_cache;
+
+/* Initializes the cache of open directories. */
+void
+dir_init (void) 
+{
+  kmem_cache_create (&dir_cache, "dir", sizeof (struct dir), NULL);
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
    given SECTOR.  Returns true if successful, false on failure. */
 bool
@@ -34,7 +44,7 @@ dir_create (block_sector_t sector, size_t entry_cnt)
 struct dir *
 dir_open (struct inode *inode) 
 {
-  struct dir *dir = calloc (1, sizeof *dir);
+  struct dir *dir = kmem_cache_alloc (&dir_cache);
   if (inode != NULL && dir != NULL)
     {
       dir->inode = inode;
@@ -44,7 +54,7 @@ dir_open (struct inode *inode)
   else
     {
       inode_close (inode);
-      free (dir);
+      kmem_cache_free (&dir_cache, dir);
       return NULL; 
     }
 }
@@ -72,7 +82,7 @@ dir_close (struct dir *dir)
   if (dir != NULL)
     {
       inode_close (dir->inode);
-      free (dir);
+      kmem_cache_free (&dir_cache, dir);
     }
 }
 
@@ -114,7 +124,11 @@ lookup (const struct dir *dir, const char *name,
 /* Searches DIR for a file with the given NAME
    and returns true if one exists, false otherwise.
    On success, sets *INODE to an inode for the file, otherwise to
-   a null pointer.  The caller must close *INODE. */
+   a null pointer.  The caller must close *INODE.
+
+   Lookups hold DIR's directory lock for reading, so they run in
+   parallel with each other but not with changes to DIR, which
+   cannot remove the entry found before its inode is open. */
 bool
 dir_lookup (const struct dir *dir, const char *name,
             struct inode **inode) 
@@ -124,10 +138,12 @@ dir_lookup (const struct dir *dir, const char *name,
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  inode_lock_dir_shared (dir->inode);
   if (lookup (dir, name, &e, NULL))
     *inode = inode_open (e.inode_sector);
   else
     *inode = NULL;
+  inode_unlock_dir_shared (dir->inode);
 
   return *inode != NULL;
 }
@@ -152,6 +168,8 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   if (*name == '\0' || strlen (name) > NAME_MAX)
     return false;
 
+  inode_lock_dir (dir->inode);
+
   /* Check that NAME is not in use. */
   if (lookup (dir, name, NULL, NULL))
     goto done;
@@ -175,6 +193,7 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 
  done:
+  inode_unlock_dir (dir->inode);
   return success;
 }
 
@@ -192,6 +211,8 @@ dir_remove (struct dir *dir, const char *name)
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  inode_lock_dir (dir->inode);
+
   /* Find directory entry. */
   if (!lookup (dir, name, &e, &ofs))
     goto done;
@@ -211,6 +232,7 @@ dir_remove (struct dir *dir, const char *name)
   success = true;
 
  done:
+  inode_unlock_dir (dir->inode);
   inode_close (inode);
   return success;
 }
@@ -222,15 +244,19 @@ bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
 {
   struct dir_entry e;
+  bool success = false;
 
+  inode_lock_dir_shared (dir->inode);
   while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
     {
       dir->pos += sizeof e;
       if (e.in_use)
         {
           strlcpy (name, e.name, NAME_MAX + 1);
-          return true;
+          success = true;
+          break;
         } 
     }
-  return false;
+  inode_unlock_dir_shared (dir->inode);
+  return success;
 }
@@ -1,9 +1,11 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ustar.h>
+#include "devices/block.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
@@ -11,6 +13,13 @@
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 
+/* Sector of the scratch device where the next file appended to
+   the ustar archive goes, shared by fsutil_append() and
+   fsutil_append_buffer(). */
+static block_sector_t append_sector;
+
+static void append_end_marker (struct block *, void *buffer);
+
 /* List files in the root directory. */
 void
 fsutil_ls (char **argv UNUSED) 
@@ -165,8 +174,7 @@ fsutil_extract (char **argv UNUSED)
 void
 fsutil_append (char **argv)
 {
-  static block_sector_t sector = 0;
-
+  block_sector_t sector = append_sector;
   const char *file_name = argv[1];
   void *buffer;
   struct file *src;
@@ -208,15 +216,68 @@ fsutil_append (char **argv)
       block_write (dst, sector++, buffer);
       size -= chunk_size;
     }
-
-  /* Write ustar end-of-archive marker, which is two consecutive
-     sectors full of zeros.  Don't advance our position past
-     them, though, in case we have more files to append. */
-  memset (buffer, 0, BLOCK_SECTOR_SIZE);
-  block_write (dst, sector, buffer);
-  block_write (dst, sector, buffer + 1);
+  append_sector = sector;
+  append_end_marker (dst, buffer);
 
   /* Finish up. */
   file_close (src);
   free (buffer);
 }
+
+/* Appends a file named FILE_NAME, whose contents are the SIZE
+   bytes at DATA, to the ustar archive on the scratch device,
+   after the files appended by fsutil_append().  Unlike the
+   latter, which runs as an action, it is meant for the kernel
+   to save data at shutdown, so it returns false on failure
+   instead of panicking. */
+bool
+fsutil_append_buffer (const char *file_name, const void *data, off_t size)
+{
+  const uint8_t *p = data;
+  block_sector_t sector = append_sector;
+  struct block *dst;
+  void *buffer;
+
+  dst = block_get_role (BLOCK_SCRATCH);
+  if (dst == NULL)
+    return false;
+  if (sector + 1 + DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE) + 2
+      > block_size (dst))
+    return false;
+  buffer = malloc (BLOCK_SECTOR_SIZE);
+  if (buffer == NULL)
+    return false;
+
+  if (!ustar_make_header (file_name, USTAR_REGULAR, size, buffer))
+    {
+      free (buffer);
+      return false;
+    }
+  block_write (dst, sector++, buffer);
+  while (size > 0) 
+    {
+      int chunk_size = size > BLOCK_SECTOR_SIZE ? BLOCK_SECTOR_SIZE : size;
+      memcpy (buffer, p, chunk_size);
+      memset (buffer + chunk_size, 0, BLOCK_SECTOR_SIZE - chunk_size);
+      block_write (dst, sector++, buffer);
+      p += chunk_size;
+      size -= chunk_size;
+    }
+  append_sector = sector;
+  append_end_marker (dst, buffer);
+
+  free (buffer);
+  return true;
+}
+
+/* Writes the ustar end-of-archive marker, which is two
+   consecutive sectors full of zeros, to DST at append_sector,
+   using the BLOCK_SECTOR_SIZE bytes at BUFFER.  Doesn't advance
+   the position past them, in case more files are appended. */
+static void
+append_end_marker (struct block *dst, void *buffer)
+{
+  memset (buffer, 0, BLOCK_SECTOR_SIZE);
+  block_write (dst, append_sector, buffer);
+  block_write (dst, append_sector + 1, buffer);
+}
@@ -1,10 +1,14 @@
 #ifndef FILESYS_FSUTIL_H
 #define FILESYS_FSUTIL_H
 
+#include <stdbool.h>
+#include "filesys/off_t.h"
+
 void fsutil_ls (char **argv);
 void fsutil_cat (char **argv);
 void fsutil_rm (char **argv);
 void fsutil_extract (char **argv);
 void fsutil_append (char **argv);
+bool fsutil_append_buffer (const char *file_name, const void *, off_t size);
 
 #endif /* filesys/fsutil.h */
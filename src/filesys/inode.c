@@ -5,7 +5,10 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -36,6 +39,8 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    struct rwlock rwlock;               /* Readers and writers of the data. */
+    struct rwlock dir_lock;             /* Directory lookups and changes. */
     struct inode_disk data;             /* Inode content. */
   };
 
@@ -57,11 +62,45 @@ byte_to_sector (const struct inode *inode, off_t pos)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Protects open_inodes and the open_cnt and removed members of
+   the inodes on it.  Opening an inode which is already open only
+   searches the list, so it holds the lock for reading and counts
+   the new opener with interrupts off; anything which adds to or
+   removes from the list holds it for writing.
+
+   Each inode's data is protected by its own rwlock instead, so
+   that different files, and readers of the same file, are
+   accessed in parallel.  An inode's length and location do not
+   change while it is open, since files do not grow. */
+static struct rwlock open_inodes_lock;
+
+/* Cache of `struct inode's.  Their locks are initialized once,
+   by inode_ctor(), and are free whenever an inode is. */
+static struct kmem_cache inode_cache;
+
+static void inode_ctor (void *);
+static struct inode *find_open_inode (block_sector_t);
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  rwlock_init (&open_inodes_lock);
+  lock_set_name (&open_inodes_lock.lock, "open inodes");
+  kmem_cache_create (&inode_cache, "inode", sizeof (struct inode),
+                     inode_ctor);
+}
+
+/* Initializes the locks of INODE_, a new object of inode_cache. */
+static void
+inode_ctor (void *inode_)
+{
+  struct inode *inode = inode_;
+
+  rwlock_init (&inode->rwlock);
+  rwlock_init (&inode->dir_lock);
+  lock_set_name (&inode->dir_lock.lock, "inode dir");
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -111,42 +150,83 @@ inode_create (block_sector_t sector, off_t length)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
   struct inode *inode;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
+  rwlock_read_acquire (&open_inodes_lock);
+  inode = find_open_inode (sector);
+  rwlock_read_release (&open_inodes_lock);
+  if (inode != NULL)
+    return inode;
+
+  /* Check again, since another thread may have opened it before
+     we got the lock for writing. */
+  rwlock_write_acquire (&open_inodes_lock);
+  inode = find_open_inode (sector);
+  if (inode != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
+      rwlock_write_release (&open_inodes_lock);
+      return inode;
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (&inode_cache);
   if (inode == NULL)
-    return NULL;
+    {
+      rwlock_write_release (&open_inodes_lock);
+      return NULL;
+    }
 
-  /* Initialize. */
+  /* Initialize.  The inode is read while the list is still
+     locked, so that nobody finds it half initialized. */
   list_push_front (&open_inodes, &inode->elem);
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
   block_read (fs_device, inode->sector, &inode->data);
+  rwlock_write_release (&open_inodes_lock);
   return inode;
 }
 
+/* Returns the open inode for SECTOR with one more opener, or a
+   null pointer if it is not open.  The caller must hold
+   open_inodes_lock, for reading or writing. */
+static struct inode *
+find_open_inode (block_sector_t sector)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e)) 
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      if (inode->sector == sector) 
+        {
+          enum intr_level old_level = intr_disable ();
+          inode->open_cnt++;
+          intr_set_level (old_level);
+          return inode;
+        }
+    }
+  return NULL;
+}
+
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      enum intr_level old_level;
+
+      /* Other openers may hold the lock for reading too. */
+      rwlock_read_acquire (&open_inodes_lock);
+      old_level = intr_disable ();
+      inode->open_cnt++;
+      intr_set_level (old_level);
+      rwlock_read_release (&open_inodes_lock);
+    }
   return inode;
 }
 
@@ -168,10 +248,12 @@ inode_close (struct inode *inode)
     return;
 
   /* Release resources if this was the last opener. */
+  rwlock_write_acquire (&open_inodes_lock);
   if (--inode->open_cnt == 0)
     {
       /* Remove from inode list and release lock. */
       list_remove (&inode->elem);
+      rwlock_write_release (&open_inodes_lock);
  
       /* Deallocate blocks if removed. */
       if (inode->removed) 
@@ -181,8 +263,10 @@ inode_close (struct inode *inode)
                             bytes_to_sectors (inode->data.length)); 
         }
 
-      free (inode); 
+      kmem_cache_free (&inode_cache, inode);
     }
+  else
+    rwlock_write_release (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -191,7 +275,9 @@ void
 inode_remove (struct inode *inode) 
 {
   ASSERT (inode != NULL);
+  rwlock_write_acquire (&open_inodes_lock);
   inode->removed = true;
+  rwlock_write_release (&open_inodes_lock);
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -204,6 +290,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
 
+  rwlock_read_acquire (&inode->rwlock);
   while (size > 0) 
     {
       /* Disk sector to read, starting byte offset within sector. */
@@ -244,6 +331,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
+  rwlock_read_release (&inode->rwlock);
   free (bounce);
 
   return bytes_read;
@@ -262,8 +350,14 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   off_t bytes_written = 0;
   uint8_t *bounce = NULL;
 
+  /* Writes are exclusive, since a partial sector is read,
+     modified and written back. */
+  rwlock_write_acquire (&inode->rwlock);
   if (inode->deny_write_cnt)
-    return 0;
+    {
+      rwlock_write_release (&inode->rwlock);
+      return 0;
+    }
 
   while (size > 0) 
     {
@@ -312,6 +406,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
+  rwlock_write_release (&inode->rwlock);
   free (bounce);
 
   return bytes_written;
@@ -322,8 +417,12 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 void
 inode_deny_write (struct inode *inode) 
 {
+  rwlock_write_acquire (&inode->rwlock);
   inode->deny_write_cnt++;
+  rwlock_read_acquire (&open_inodes_lock);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  rwlock_read_release (&open_inodes_lock);
+  rwlock_write_release (&inode->rwlock);
 }
 
 /* Re-enables writes to INODE.
@@ -332,9 +431,13 @@ inode_deny_write (struct inode *inode)
 void
 inode_allow_write (struct inode *inode) 
 {
+  rwlock_write_acquire (&inode->rwlock);
   ASSERT (inode->deny_write_cnt > 0);
+  rwlock_read_acquire (&open_inodes_lock);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  rwlock_read_release (&open_inodes_lock);
   inode->deny_write_cnt--;
+  rwlock_write_release (&inode->rwlock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -343,3 +446,38 @@ inode_length (const struct inode *inode)
 {
   return inode->data.length;
 }
+
+/* Acquires INODE's directory lock for changing the entries of
+   the directory stored in INODE, so that the directory code's
+   check for a free name and its write of the new entry are
+   atomic. */
+void
+inode_lock_dir (struct inode *inode)
+{
+  rwlock_write_acquire (&inode->dir_lock);
+}
+
+/* Releases INODE's directory lock, acquired with
+   inode_lock_dir(). */
+void
+inode_unlock_dir (struct inode *inode)
+{
+  rwlock_write_release (&inode->dir_lock);
+}
+
+/* Acquires INODE's directory lock for reading the entries of the
+   directory stored in INODE.  Any number of readers may hold it
+   at once. */
+void
+inode_lock_dir_shared (struct inode *inode)
+{
+  rwlock_read_acquire (&inode->dir_lock);
+}
+
+/* Releases INODE's directory lock, acquired with
+   inode_lock_dir_shared(). */
+void
+inode_unlock_dir_shared (struct inode *inode)
+{
+  rwlock_read_release (&inode->dir_lock);
+}
@@ -0,0 +1,143 @@
+#include "plist.h"
+#include "../debug.h"
+
+/* The elements of a priority list form a single list.  The
+   elements of priority P, if any, run from the element just
+   after the tail of the next higher non-empty priority (or from
+   the beginning of the list if there is none) up to and
+   including TAILS[P]. */
+
+static int highest_bit (uint64_t);
+static int lowest_bit (uint64_t);
+static struct list_elem *level_head (struct plist *, int priority);
+
+/* Initializes PL as an empty priority list. */
+void
+plist_init (struct plist *pl)
+{
+  ASSERT (pl != NULL);
+
+  list_init (&pl->elems);
+  pl->bitmap = 0;
+}
+
+/* Pushes ELEM at PRIORITY into PL, behind the elements already
+   there with the same priority. */
+void
+plist_push (struct plist *pl, struct list_elem *elem, int priority)
+{
+  ASSERT (pl != NULL);
+  ASSERT (elem != NULL);
+  ASSERT (priority >= 0 && priority < PLIST_LEVELS);
+
+  if (pl->bitmap & ((uint64_t) 1 << priority))
+    list_insert (list_next (pl->tails[priority]), elem);
+  else
+    {
+      list_insert (level_head (pl, priority), elem);
+      pl->bitmap |= (uint64_t) 1 << priority;
+    }
+  pl->tails[priority] = elem;
+}
+
+/* Removes ELEM, which was pushed at PRIORITY, from PL. */
+void
+plist_remove (struct plist *pl, struct list_elem *elem, int priority)
+{
+  ASSERT (pl != NULL);
+  ASSERT (elem != NULL);
+  ASSERT (priority >= 0 && priority < PLIST_LEVELS);
+  ASSERT (pl->bitmap & ((uint64_t) 1 << priority));
+
+  if (pl->tails[priority] == elem)
+    {
+      if (level_head (pl, priority) == elem)
+        pl->bitmap &= ~((uint64_t) 1 << priority);
+      else
+        pl->tails[priority] = list_prev (elem);
+    }
+  list_remove (elem);
+}
+
+/* Removes and returns the element pushed first among those of
+   the highest priority in PL, which must not be empty. */
+struct list_elem *
+plist_pop_max (struct plist *pl)
+{
+  struct list_elem *front = plist_front (pl);
+  plist_remove (pl, front, highest_bit (pl->bitmap));
+  return front;
+}
+
+/* Returns the element pushed first among those of the highest
+   priority in PL, which must not be empty. */
+struct list_elem *
+plist_front (struct plist *pl)
+{
+  ASSERT (!plist_empty (pl));
+
+  return list_front (&pl->elems);
+}
+
+/* Returns the highest priority with an element in PL, or -1 if
+   PL is empty. */
+int
+plist_max_priority (const struct plist *pl)
+{
+  ASSERT (pl != NULL);
+
+  return highest_bit (pl->bitmap);
+}
+
+/* Returns true if PL is empty, false otherwise. */
+bool
+plist_empty (const struct plist *pl)
+{
+  ASSERT (pl != NULL);
+
+  return pl->bitmap == 0;
+}
+
+/* Returns the first element of PRIORITY in PL, or the element
+   it would be inserted before if PRIORITY is empty. */
+static struct list_elem *
+level_head (struct plist *pl, int priority)
+{
+  uint64_t higher = priority + 1 < PLIST_LEVELS
+                    ? pl->bitmap & ~(((uint64_t) 2 << priority) - 1)
+                    : 0;
+
+  if (higher == 0)
+    return list_begin (&pl->elems);
+  return list_next (pl->tails[lowest_bit (higher)]);
+}
+
+/* Returns the index of the most significant bit set in BITS, or
+   -1 if BITS is 0.  Each 32-bit half is scanned separately,
+   which keeps 64-bit helpers from libgcc out of the kernel. */
+static int
+highest_bit (uint64_t bits)
+{
+  uint32_t high = bits >> 32;
+  uint32_t low = bits;
+
+  if (high != 0)
+    return 63 - __builtin_clz (high);
+  if (low != 0)
+    return 31 - __builtin_clz (low);
+  return -1;
+}
+
+/* Returns the index of the least significant bit set in BITS,
+   which must not be 0. */
+static int
+lowest_bit (uint64_t bits)
+{
+  uint32_t high = bits >> 32;
+  uint32_t low = bits;
+
+  ASSERT (bits != 0);
+  if (low != 0)
+    return __builtin_ctz (low);
+  return 32 + __builtin_ctz (high);
+}
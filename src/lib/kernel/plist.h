@@ -0,0 +1,48 @@
+#ifndef __LIB_KERNEL_PLIST_H
+#define __LIB_KERNEL_PLIST_H
+
+/* Priority list.
+
+   A linked list whose elements are each pushed at one of
+   PLIST_LEVELS integer priorities.  The list is kept in
+   decreasing order of priority, and elements of equal priority
+   stay in the order they were pushed in.
+
+   The list is bucketed by priority: a bitmap records which
+   priorities have elements, and the last element of each
+   priority is remembered.  Pushing, removing and popping the
+   first element of the highest priority all take constant time.
+
+   Elements are ordinary struct list_elems (see
+   lib/kernel/list.h), so list_entry converts them back to the
+   structure they are embedded in.  The list does not record the
+   priority of each element: the caller has to remember it and
+   pass it back to plist_remove(). */
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Number of priorities, from 0 to PLIST_LEVELS - 1. */
+#define PLIST_LEVELS 64
+
+/* Priority list. */
+struct plist
+  {
+    struct list elems;          /* Elements, highest priority first. */
+    uint64_t bitmap;            /* Bit P set if priority P is not empty. */
+    struct list_elem *tails[PLIST_LEVELS]; /* Last element of each
+                                              non-empty priority. */
+  };
+
+void plist_init (struct plist *);
+
+void plist_push (struct plist *, struct list_elem *, int priority);
+void plist_remove (struct plist *, struct list_elem *, int priority);
+struct list_elem *plist_pop_max (struct plist *);
+
+struct list_elem *plist_front (struct plist *);
+int plist_max_priority (const struct plist *);
+bool plist_empty (const struct plist *);
+
+#endif /* lib/kernel/plist.h */
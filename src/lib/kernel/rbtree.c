@@ -0,0 +1,352 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* Red-black tree, after Cormen, Leiserson, Rivest and Stein,
+   "Introduction to Algorithms", chapter 13, with null pointers
+   standing in for the black leaves. */
+
+static void rotate_left (struct rb_tree *, struct rb_elem *);
+static void rotate_right (struct rb_tree *, struct rb_elem *);
+static void transplant (struct rb_tree *, struct rb_elem *,
+                        struct rb_elem *);
+static void insert_fixup (struct rb_tree *, struct rb_elem *);
+static void remove_fixup (struct rb_tree *, struct rb_elem *,
+                          struct rb_elem *);
+
+/* Returns true if E is a red node, false if it is black or a
+   null leaf. */
+static inline bool
+is_red (const struct rb_elem *e) 
+{
+  return e != NULL && e->red;
+}
+
+/* Initializes tree T to order its elements with LESS given
+   auxiliary data AUX. */
+void
+rb_init (struct rb_tree *t, rb_less_func *less, void *aux) 
+{
+  ASSERT (t != NULL);
+  ASSERT (less != NULL);
+
+  t->root = NULL;
+  t->first = NULL;
+  t->elem_cnt = 0;
+  t->less = less;
+  t->aux = aux;
+}
+
+/* Inserts E into T, after any elements that compare equal to
+   it. */
+void
+rb_insert (struct rb_tree *t, struct rb_elem *e) 
+{
+  struct rb_elem *parent = NULL;
+  struct rb_elem **link = &t->root;
+  bool leftmost = true;
+
+  ASSERT (t != NULL);
+  ASSERT (e != NULL);
+
+  while (*link != NULL) 
+    {
+      parent = *link;
+      if (t->less (e, parent, t->aux))
+        link = &parent->left;
+      else
+        {
+          link = &parent->right;
+          leftmost = false;
+        }
+    }
+
+  e->parent = parent;
+  e->left = e->right = NULL;
+  e->red = true;
+  *link = e;
+  if (leftmost)
+    t->first = e;
+  t->elem_cnt++;
+
+  insert_fixup (t, e);
+}
+
+/* Removes E, which must be in T, from T. */
+void
+rb_remove (struct rb_tree *t, struct rb_elem *e) 
+{
+  struct rb_elem *x, *x_parent;
+  bool removed_red = e->red;
+
+  ASSERT (t != NULL);
+  ASSERT (e != NULL);
+  ASSERT (t->elem_cnt > 0);
+
+  if (t->first == e)
+    t->first = rb_next (e);
+
+  if (e->left == NULL) 
+    {
+      x = e->right;
+      x_parent = e->parent;
+      transplant (t, e, e->right);
+    }
+  else if (e->right == NULL) 
+    {
+      x = e->left;
+      x_parent = e->parent;
+      transplant (t, e, e->left);
+    }
+  else 
+    {
+      /* Replace E by its successor Y, the smallest element of its
+         right subtree, which has no left child. */
+      struct rb_elem *y = e->right;
+      while (y->left != NULL)
+        y = y->left;
+
+      removed_red = y->red;
+      x = y->right;
+      if (y->parent == e)
+        x_parent = y;
+      else 
+        {
+          x_parent = y->parent;
+          transplant (t, y, y->right);
+          y->right = e->right;
+          y->right->parent = y;
+        }
+      transplant (t, e, y);
+      y->left = e->left;
+      y->left->parent = y;
+      y->red = e->red;
+    }
+  t->elem_cnt--;
+
+  if (!removed_red)
+    remove_fixup (t, x, x_parent);
+}
+
+/* Returns the smallest element of T, or a null pointer if T is
+   empty. */
+struct rb_elem *
+rb_first (const struct rb_tree *t) 
+{
+  ASSERT (t != NULL);
+
+  return t->first;
+}
+
+/* Returns the element that follows E in its tree, or a null
+   pointer if E is the greatest element. */
+struct rb_elem *
+rb_next (const struct rb_elem *e) 
+{
+  ASSERT (e != NULL);
+
+  if (e->right != NULL) 
+    {
+      e = e->right;
+      while (e->left != NULL)
+        e = e->left;
+      return (struct rb_elem *) e;
+    }
+  while (e->parent != NULL && e == e->parent->right)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the number of elements in T. */
+size_t
+rb_size (const struct rb_tree *t) 
+{
+  ASSERT (t != NULL);
+
+  return t->elem_cnt;
+}
+
+/* Returns true if T is empty, false otherwise. */
+bool
+rb_empty (const struct rb_tree *t) 
+{
+  ASSERT (t != NULL);
+
+  return t->root == NULL;
+}
+
+/* Rotates the subtree rooted at X to the left, so that its right
+   child takes its place. */
+static void
+rotate_left (struct rb_tree *t, struct rb_elem *x) 
+{
+  struct rb_elem *y = x->right;
+
+  x->right = y->left;
+  if (y->left != NULL)
+    y->left->parent = x;
+  transplant (t, x, y);
+  y->left = x;
+  x->parent = y;
+}
+
+/* Rotates the subtree rooted at X to the right, so that its left
+   child takes its place. */
+static void
+rotate_right (struct rb_tree *t, struct rb_elem *x) 
+{
+  struct rb_elem *y = x->left;
+
+  x->left = y->right;
+  if (y->right != NULL)
+    y->right->parent = x;
+  transplant (t, x, y);
+  y->right = x;
+  x->parent = y;
+}
+
+/* Puts V, which may be null, in U's place under U's parent. */
+static void
+transplant (struct rb_tree *t, struct rb_elem *u, struct rb_elem *v) 
+{
+  if (u->parent == NULL)
+    t->root = v;
+  else if (u == u->parent->left)
+    u->parent->left = v;
+  else
+    u->parent->right = v;
+  if (v != NULL)
+    v->parent = u->parent;
+}
+
+/* Restores the red-black properties after red node E was
+   inserted. */
+static void
+insert_fixup (struct rb_tree *t, struct rb_elem *e) 
+{
+  while (is_red (e->parent)) 
+    {
+      /* A red parent is never the root, so the grandparent
+         exists. */
+      struct rb_elem *p = e->parent;
+      struct rb_elem *g = p->parent;
+
+      if (p == g->left) 
+        {
+          struct rb_elem *u = g->right;
+          if (is_red (u)) 
+            {
+              p->red = u->red = false;
+              g->red = true;
+              e = g;
+              continue;
+            }
+          if (e == p->right) 
+            {
+              rotate_left (t, p);
+              e = p;
+              p = e->parent;
+            }
+          p->red = false;
+          g->red = true;
+          rotate_right (t, g);
+        }
+      else 
+        {
+          struct rb_elem *u = g->left;
+          if (is_red (u)) 
+            {
+              p->red = u->red = false;
+              g->red = true;
+              e = g;
+              continue;
+            }
+          if (e == p->left) 
+            {
+              rotate_right (t, p);
+              e = p;
+              p = e->parent;
+            }
+          p->red = false;
+          g->red = true;
+          rotate_left (t, g);
+        }
+    }
+  t->root->red = false;
+}
+
+/* Restores the red-black properties after a black node was
+   removed.  X, which may be null, is the node that took its
+   place and carries an extra black; PARENT is X's parent. */
+static void
+remove_fixup (struct rb_tree *t, struct rb_elem *x, struct rb_elem *parent) 
+{
+  while (x != t->root && !is_red (x)) 
+    {
+      if (x == parent->left) 
+        {
+          struct rb_elem *w = parent->right;
+          if (is_red (w)) 
+            {
+              w->red = false;
+              parent->red = true;
+              rotate_left (t, parent);
+              w = parent->right;
+            }
+          if (!is_red (w->left) && !is_red (w->right)) 
+            {
+              w->red = true;
+              x = parent;
+              parent = x->parent;
+            }
+          else 
+            {
+              if (!is_red (w->right)) 
+                {
+                  w->left->red = false;
+                  w->red = true;
+                  rotate_right (t, w);
+                  w = parent->right;
+                }
+              w->red = parent->red;
+              parent->red = false;
+              w->right->red = false;
+              rotate_left (t, parent);
+              x = t->root;
+            }
+        }
+      else 
+        {
+          struct rb_elem *w = parent->left;
+          if (is_red (w)) 
+            {
+              w->red = false;
+              parent->red = true;
+              rotate_right (t, parent);
+              w = parent->left;
+            }
+          if (!is_red (w->right) && !is_red (w->left)) 
+            {
+              w->red = true;
+              x = parent;
+              parent = x->parent;
+            }
+          else 
+            {
+              if (!is_red (w->left)) 
+                {
+                  w->right->red = false;
+                  w->red = true;
+                  rotate_left (t, w);
+                  w = parent->left;
+                }
+              w->red = parent->red;
+              parent->red = false;
+              w->left->red = false;
+              rotate_right (t, parent);
+              x = t->root;
+            }
+        }
+    }
+  if (x != NULL)
+    x->red = false;
+}
@@ -0,0 +1,20 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stdint.h>
+
+/* Scheduler accounting of a thread, as returned by the getrusage
+   system call.  Shared between the kernel and user programs.
+   Times are measured with the TSC, in microseconds. */
+struct rusage
+  {
+    int64_t run_us;             /* Time spent running. */
+    int64_t wait_us;            /* Time spent ready, waiting for a CPU. */
+    int64_t lock_wait_us;       /* Time spent blocked on locks. */
+    uint32_t voluntary_switches;   /* Gave up the CPU by blocking. */
+    uint32_t involuntary_switches; /* Preempted, or yielded while ready. */
+    uint32_t lock_blocks;       /* Times blocked on a held lock. */
+    uint32_t reserved;
+  };
+
+#endif /* lib/rusage.h */
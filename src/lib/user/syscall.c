@@ -182,3 +182,9 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+void
+getrusage (struct rusage *usage)
+{
+  syscall1 (SYS_GETRUSAGE, usage);
+}
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <rusage.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +46,7 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+void getrusage (struct rusage *);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,75 @@
+/* Checks that sleeps shorter than a timer tick block the thread
+   instead of spinning, and that they last at least as long as
+   asked but well under a tick.
+
+   The main thread sleeps SLEEP_US microseconds SLEEP_CNT times
+   and measures each sleep with timer_ns().  Meanwhile a thread
+   of lower priority counts in a loop, which it can only do while
+   the main thread is blocked. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEP_CNT 20
+#define SLEEP_US 500
+
+static volatile bool done;
+static volatile int64_t spin_cnt;
+static struct semaphore done_sema;
+
+static void counter_thread (void *);
+
+void
+test_alarm_usleep (void) 
+{
+  int64_t shortest = INT64_MAX, longest = 0;
+  int64_t spins;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done_sema, 0);
+  done = false;
+  spin_cnt = 0;
+  thread_create ("counter", PRI_MIN, counter_thread, NULL);
+
+  msg ("Sleeping %d us %d times...", SLEEP_US, SLEEP_CNT);
+  for (i = 0; i < SLEEP_CNT; i++) 
+    {
+      int64_t start = timer_ns ();
+      int64_t slept;
+
+      timer_usleep (SLEEP_US);
+      slept = timer_ns () - start;
+      if (slept < shortest)
+        shortest = slept;
+      if (slept > longest)
+        longest = slept;
+    }
+  spins = spin_cnt;
+  done = true;
+  sema_down (&done_sema);
+
+  if (shortest < SLEEP_US * 1000LL)
+    fail ("a sleep lasted only %"PRId64" ns", shortest);
+  if (longest >= 1000000000LL / TIMER_FREQ)
+    fail ("a sleep lasted %"PRId64" ns, a tick or more", longest);
+  if (spins == 0)
+    fail ("lower priority thread never ran while sleeping");
+  msg ("All sleeps lasted at least %d us and less than a tick.", SLEEP_US);
+  msg ("Lower priority thread ran while sleeping.");
+}
+
+static void
+counter_thread (void *aux UNUSED) 
+{
+  while (!done)
+    spin_cnt++;
+  sema_up (&done_sema);
+}
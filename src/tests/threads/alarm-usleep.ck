@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-usleep) begin
+(alarm-usleep) Sleeping 500 us 20 times...
+(alarm-usleep) All sleeps lasted at least 500 us and less than a tick.
+(alarm-usleep) Lower priority thread ran while sleeping.
+(alarm-usleep) end
+EOF
+pass;
@@ -0,0 +1,116 @@
+/* Stresses the timing wheel behind timer_sleep().
+
+   Creates 2000 threads that each sleep until a random deadline
+   up to 20 seconds away, so that sleepers land in both the
+   per-tick slots and the outer levels of the wheel and many of
+   them share a slot.  Every tenth thread instead asks for a
+   deadline 1000 seconds away and is woken early by the main
+   thread with timer_wake().  Checks that no thread wakes up
+   before its deadline and that every thread wakes up.
+
+   Needs enough memory for 2000 thread pages. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 2000
+#define EARLY_STRIDE 10
+#define MAX_SLEEP (20 * TIMER_FREQ)
+#define EARLY_SLEEP (1000 * TIMER_FREQ)
+
+struct sleeper 
+  {
+    struct thread *thread;      /* Set once the thread runs. */
+    int64_t duration;           /* Ticks to sleep. */
+    int64_t deadline;           /* Tick it may wake up at. */
+    int64_t woke;               /* Tick it woke up at. */
+  };
+
+static struct sleeper sleepers[THREAD_CNT];
+static struct semaphore done_sema;
+
+static void sleeper_thread (void *);
+
+void
+test_alarm_wheel (void) 
+{
+  int early_cnt = 0;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done_sema, 0);
+
+  msg ("Sleeping %d threads at random deadlines...", THREAD_CNT);
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      struct sleeper *s = &sleepers[i];
+      char name[16];
+
+      s->thread = NULL;
+      s->woke = -1;
+      if (i % EARLY_STRIDE == 0)
+        s->duration = EARLY_SLEEP;
+      else
+        s->duration = 1 + random_ulong () % MAX_SLEEP;
+
+      snprintf (name, sizeof name, "sleeper %d", i);
+      if (thread_create (name, PRI_DEFAULT, sleeper_thread, s) == TID_ERROR)
+        fail ("could not create thread %d", i);
+    }
+
+  msg ("Waking every %dth thread early...", EARLY_STRIDE);
+  for (i = 0; i < THREAD_CNT; i += EARLY_STRIDE) 
+    {
+      struct sleeper *s = &sleepers[i];
+      for (;;)
+        {
+          enum intr_level old_level = intr_disable ();
+          bool woken = s->thread != NULL && timer_wake (s->thread);
+          intr_set_level (old_level);
+          if (woken)
+            break;
+
+          /* Not asleep yet. */
+          timer_sleep (1);
+        }
+      early_cnt++;
+    }
+
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done_sema);
+
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      struct sleeper *s = &sleepers[i];
+      if (i % EARLY_STRIDE == 0)
+        {
+          if (s->woke >= s->deadline)
+            fail ("thread %d was not woken early", i);
+        }
+      else if (s->woke < s->deadline)
+        fail ("thread %d woke up at tick %"PRId64", before its deadline %"
+              PRId64, i, s->woke, s->deadline);
+    }
+  msg ("%d threads woke up early, the others on time.", early_cnt);
+}
+
+static void
+sleeper_thread (void *s_) 
+{
+  struct sleeper *s = s_;
+
+  s->deadline = timer_ticks () + s->duration;
+  s->thread = thread_current ();
+  timer_sleep (s->duration);
+  s->woke = timer_ticks ();
+  sema_up (&done_sema);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-wheel) begin
+(alarm-wheel) Sleeping 2000 threads at random deadlines...
+(alarm-wheel) Waking every 10th thread early...
+(alarm-wheel) 200 threads woke up early, the others on time.
+(alarm-wheel) end
+EOF
+pass;
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-deadline-tickless) begin
+(edf-deadline-tickless) Starting 3 real-time threads...
+(edf-deadline-tickless) Admission of another 50% of the CPU refused.
+(edf-deadline-tickless) Thread 0 missed 0 deadlines.
+(edf-deadline-tickless) Thread 1 missed 0 deadlines.
+(edf-deadline-tickless) Thread 2 missed 0 deadlines.
+(edf-deadline-tickless) end
+EOF
+pass;
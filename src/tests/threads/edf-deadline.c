@@ -0,0 +1,137 @@
+/* Measures deadline misses of earliest-deadline-first threads
+   under background load.
+
+   Three real-time threads with periods of 10, 20 and 40 ticks
+   each reserve a fifth of the CPU and run one job per period for
+   5 seconds, while four threads of the highest priority spin.
+   Every job does a little less work than its budget, so with a
+   total reservation of 60% no deadline should be missed.  A
+   fourth real-time thread asking for another 50% of the CPU must
+   be refused by admission control.
+
+   edf-deadline-tickless runs the same threads under "-tickless"
+   without the load, so that the CPU is idle between jobs and the
+   stopped tick must still release every job on time. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define EDF_CNT 3
+#define LOAD_CNT 4
+#define RUN_TIME (5 * TIMER_FREQ)
+
+struct edf_info 
+  {
+    int64_t period;             /* Ticks between releases. */
+    int64_t budget;             /* Ticks of CPU per period. */
+    int jobs;                   /* Jobs completed. */
+    int misses;                 /* Jobs completed late. */
+  };
+
+static struct edf_info edf_infos[EDF_CNT] =
+  {
+    {10, 2, 0, 0},
+    {20, 4, 0, 0},
+    {40, 8, 0, 0},
+  };
+
+static struct semaphore admitted_sema;
+static struct semaphore done_sema;
+static int64_t end_time;
+
+static void edf_thread (void *);
+static void load_thread (void *);
+static void edf_deadline (int load_cnt);
+
+void
+test_edf_deadline (void) 
+{
+  edf_deadline (LOAD_CNT);
+}
+
+void
+test_edf_deadline_tickless (void) 
+{
+  ASSERT (timer_tickless);
+  edf_deadline (0);
+}
+
+static void
+edf_deadline (int load_cnt) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&admitted_sema, 0);
+  sema_init (&done_sema, 0);
+  end_time = timer_ticks () + RUN_TIME;
+  thread_set_priority (PRI_MAX);
+
+  msg ("Starting %d real-time threads...", EDF_CNT);
+  for (i = 0; i < EDF_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "edf %d", i);
+      thread_create (name, PRI_MAX, edf_thread, &edf_infos[i]);
+    }
+
+  /* Wait for them to join the real-time class. */
+  for (i = 0; i < EDF_CNT; i++)
+    sema_down (&admitted_sema);
+  if (thread_set_edf (10, 5, 10))
+    fail ("admitted a real-time thread beyond the CPU's capacity");
+  msg ("Admission of another 50%% of the CPU refused.");
+
+  if (load_cnt > 0)
+    msg ("Starting %d load threads...", load_cnt);
+  for (i = 0; i < load_cnt; i++)
+    thread_create ("load", PRI_MAX, load_thread, NULL);
+
+  for (i = 0; i < EDF_CNT + load_cnt; i++)
+    sema_down (&done_sema);
+
+  for (i = 0; i < EDF_CNT; i++) 
+    {
+      struct edf_info *info = &edf_infos[i];
+      if (info->jobs < RUN_TIME / info->period - 1)
+        fail ("thread %d completed only %d jobs", i, info->jobs);
+      msg ("Thread %d missed %d deadlines.", i, info->misses);
+    }
+}
+
+static void
+edf_thread (void *info_) 
+{
+  struct edf_info *info = info_;
+
+  if (!thread_set_edf (info->period, info->budget, info->period))
+    fail ("real-time thread refused");
+  sema_up (&admitted_sema);
+
+  while (timer_ticks () < end_time) 
+    {
+      /* Busy for one tick less than the budget. */
+      int64_t start = timer_ticks ();
+      while (timer_elapsed (start) < info->budget - 1)
+        continue;
+      info->jobs++;
+      thread_edf_wait_next_period ();
+    }
+  info->misses = thread_edf_misses ();
+  thread_clear_edf ();
+  sema_up (&done_sema);
+}
+
+static void
+load_thread (void *aux UNUSED) 
+{
+  while (timer_ticks () < end_time)
+    continue;
+  sema_up (&done_sema);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-deadline) begin
+(edf-deadline) Starting 3 real-time threads...
+(edf-deadline) Admission of another 50% of the CPU refused.
+(edf-deadline) Starting 4 load threads...
+(edf-deadline) Thread 0 missed 0 deadlines.
+(edf-deadline) Thread 1 missed 0 deadlines.
+(edf-deadline) Thread 2 missed 0 deadlines.
+(edf-deadline) end
+EOF
+pass;
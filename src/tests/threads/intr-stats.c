@@ -0,0 +1,16 @@
+/* Sleeps for 10 timer ticks, so that the statistics of the
+   interrupt handlers printed at shutdown show at least as many
+   calls to the timer interrupt handler, in their histogram as
+   well. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "devices/timer.h"
+
+void
+test_intr_stats (void) 
+{
+  timer_sleep (10);
+  msg ("Slept for 10 ticks.");
+}
@@ -0,0 +1,29 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+check_expected ([<<'EOF']);
+(intr-stats) begin
+(intr-stats) Slept for 10 ticks.
+(intr-stats) end
+EOF
+
+my ($i) = grep ($output[$_] =~ /^  0x20 8254 Timer /, 0...$#output);
+fail "missing timer interrupt statistics in output" unless defined $i;
+my ($calls, $total, $longest)
+  = $output[$i] =~ /^  0x20 8254 Timer +(\d+) +(\d+) +(\d+)$/;
+fail "malformed timer interrupt statistics" unless defined $longest;
+fail "only $calls calls to the timer interrupt handler" if $calls < 10;
+fail "longest call of $longest us exceeds total of $total us"
+  if $longest > $total;
+
+my ($histogram) = 0;
+$histogram += $1 while $output[$i + 1] =~ /(?:<|>=)\d+:(\d+)/g;
+fail "histogram counts $histogram calls, not between 10 and $calls"
+  if $histogram < 10 || $histogram > $calls;
+
+pass;
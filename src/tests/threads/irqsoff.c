@@ -0,0 +1,22 @@
+/* Keeps interrupts off for 5 ms under -irqsoff, which must be
+   the longest interrupts-off section reported at shutdown, far
+   longer than any the kernel itself should have. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "devices/timer.h"
+
+void
+test_irqsoff (void) 
+{
+  enum intr_level old_level;
+
+  ASSERT (intr_irqsoff != 0);
+
+  old_level = intr_disable ();
+  timer_mdelay (5);
+  intr_set_level (old_level);
+  msg ("Interrupts were off for 5 ms.");
+}
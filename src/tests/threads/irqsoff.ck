@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+check_expected ([<<'EOF']);
+(irqsoff) begin
+(irqsoff) Interrupts were off for 5 ms.
+(irqsoff) end
+EOF
+
+my ($i) = grep ($output[$_] =~ /^Interrupts-off sections/, 0...$#output);
+fail "missing interrupts-off sections in output" unless defined $i;
+my ($longest) = $output[$i + 2] =~ /^\s+(\d+)\s+\d+\s+\d+\s+0x[0-9a-f]+/;
+fail "missing longest interrupts-off section" unless defined $longest;
+fail "longest interrupts-off section took $longest us, not about 5 ms"
+  if $longest < 2500;
+fail "missing interrupts-off addresses"
+  unless grep (/^Irqsoff addresses:( 0x[0-9a-f]+ 0x[0-9a-f]+)+$/, @output);
+
+pass;
@@ -0,0 +1,60 @@
+/* Checks the contention statistics gathered under -lockstat.
+
+   The main thread holds a lock for a few ticks while three
+   higher-priority threads block on it, then releases it so that
+   each of them acquires it in turn.  The lock must have been
+   acquired four times, three of them after waiting, and the
+   times spent waiting and holding it must add up. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func lockstat_thread;
+static struct lock lock;
+
+void
+test_lockstat (void) 
+{
+  const struct lock_stats *s;
+  int i;
+
+  ASSERT (synch_lockstat);
+
+  lock_init (&lock);
+  lock_set_name (&lock, "lockstat");
+  s = lock.stats;
+  lock_acquire (&lock);
+  for (i = 0; i < 3; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "thread %d", i);
+      thread_create (name, PRI_DEFAULT + 1, lockstat_thread, NULL);
+    }
+  timer_sleep (3);
+  lock_release (&lock);
+
+  msg ("Lock acquired %"PRIu32" times, %"PRIu32" of them after waiting.",
+       s->acquired_cnt, s->contended_cnt);
+  if (s->max_wait_ns < 2 * (1000 * 1000 * 1000 / TIMER_FREQ))
+    fail ("Longest wait of %"PRId64" ns is shorter than 2 ticks.",
+          s->max_wait_ns);
+  if (s->wait_ns < s->max_wait_ns)
+    fail ("Total wait of %"PRId64" ns is shorter than the longest one.",
+          s->wait_ns);
+  if (s->hold_ns < s->max_wait_ns)
+    fail ("Lock held for %"PRId64" ns, less than the longest wait.",
+          s->hold_ns);
+  msg ("Wait and hold times are consistent.");
+}
+
+static void
+lockstat_thread (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  lock_release (&lock);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(lockstat) begin
+(lockstat) Lock acquired 4 times, 3 of them after waiting.
+(lockstat) Wait and hold times are consistent.
+(lockstat) end
+EOF
+pass;
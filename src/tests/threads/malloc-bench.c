@@ -0,0 +1,118 @@
+/* Compares the cost of malloc() and free() of a small block with
+   and without the magazines in front of the descriptors.
+
+   With the magazines, a malloc() and free() pair only pops and
+   pushes a magazine with interrupts off.  Without them, turned
+   off with malloc_set_magazines(), every call takes the
+   descriptor's lock and its free list, as before there were
+   magazines.  The test also times batches of allocations too
+   big for the magazines, which go through the depot.
+
+   Each case runs ROUND_CNT times and the fastest round counts,
+   since a timer interrupt may fall into any of them.  The times
+   are reported, not checked, because they depend on the machine
+   the test runs on. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "devices/timer.h"
+
+/* Size of the blocks allocated. */
+#define BLOCK_SIZE 32
+
+/* Number of pairs timed in a round. */
+#define PAIR_CNT 1024
+
+/* Number of rounds of each case. */
+#define ROUND_CNT 20
+
+/* Blocks allocated at once to overflow the magazines: more than
+   two magazines plus a depot of them hold. */
+#define BATCH_CNT 128
+
+static int64_t time_pairs (void);
+static int64_t time_batches (void);
+static int64_t fastest (int64_t (*) (void));
+
+void
+test_malloc_bench (void) 
+{
+  int64_t pairs, batches;
+
+  pairs = fastest (time_pairs);
+  batches = fastest (time_batches);
+  msg ("magazines: %"PRId64" ns per pair, %"PRId64" ns per pair "
+       "in batches.", pairs / PAIR_CNT, batches / PAIR_CNT);
+
+  malloc_set_magazines (false);
+  pairs = fastest (time_pairs);
+  batches = fastest (time_batches);
+  malloc_set_magazines (true);
+  msg ("no magazines: %"PRId64" ns per pair, %"PRId64" ns per pair "
+       "in batches.", pairs / PAIR_CNT, batches / PAIR_CNT);
+}
+
+/* Returns the shortest time, in ns, taken by ROUND_CNT calls of
+   FUNC. */
+static int64_t
+fastest (int64_t (*func) (void)) 
+{
+  int64_t best = INT64_MAX;
+  int i;
+
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      int64_t t = func ();
+      if (t < best)
+        best = t;
+    }
+  return best;
+}
+
+/* Returns the time, in ns, taken by PAIR_CNT malloc() and free()
+   pairs, after a pair that loads the magazines. */
+static int64_t
+time_pairs (void) 
+{
+  int64_t start;
+  int i;
+
+  free (malloc (BLOCK_SIZE));
+
+  start = timer_ns ();
+  for (i = 0; i < PAIR_CNT; i++)
+    {
+      void *p = malloc (BLOCK_SIZE);
+      if (p == NULL)
+        fail ("malloc(%d) failed", BLOCK_SIZE);
+      free (p);
+    }
+  return timer_ns () - start;
+}
+
+/* Returns the time, in ns, taken to allocate and then free
+   PAIR_CNT blocks in batches of BATCH_CNT. */
+static int64_t
+time_batches (void) 
+{
+  static void *blocks[BATCH_CNT];
+  int64_t start;
+  int i, j;
+
+  start = timer_ns ();
+  for (i = 0; i < PAIR_CNT / BATCH_CNT; i++)
+    {
+      for (j = 0; j < BATCH_CNT; j++)
+        {
+          blocks[j] = malloc (BLOCK_SIZE);
+          if (blocks[j] == NULL)
+            fail ("malloc(%d) failed", BLOCK_SIZE);
+        }
+      for (j = 0; j < BATCH_CNT; j++)
+        free (blocks[j]);
+    }
+  return timer_ns () - start;
+}
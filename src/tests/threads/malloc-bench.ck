@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+foreach my $kind ('magazines', 'no magazines') {
+    fail "missing timing with $kind in output"
+      unless grep (/^\(malloc-bench\) $kind: \d+ ns per pair, \d+ ns per pair in batches\.$/,
+		   @output);
+}
+
+pass;
@@ -0,0 +1,85 @@
+/* Allocates blocks of many sizes, from a few bytes to a few
+   pages, so that every size class is used, including those
+   whose arenas span several pages, and blocks bigger than any
+   class.  Fills each block and checks that none overlaps
+   another, grows some with realloc(), then frees them all in a
+   scrambled order, which must find the arena of each block,
+   even one that lies beyond the first page of its arena. */
+
+#include <random.h>
+#include <stdint.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+
+#define BLOCK_CNT 200
+
+static size_t sizes[BLOCK_CNT];
+static uint8_t *blocks[BLOCK_CNT];
+
+static void check_block (int i);
+
+void
+test_malloc_classes (void) 
+{
+  int order[BLOCK_CNT];
+  int i;
+
+  random_init (0);
+  for (i = 0; i < BLOCK_CNT; i++)
+    {
+      /* Mostly small sizes, a few up to 3 pages. */
+      sizes[i] = i % 10 == 0 ? random_ulong () % 12288 + 1
+                 : random_ulong () % 4000 + 1;
+      blocks[i] = malloc (sizes[i]);
+      if (blocks[i] == NULL)
+        fail ("malloc(%zu) failed", sizes[i]);
+      memset (blocks[i], i, sizes[i]);
+    }
+  for (i = 0; i < BLOCK_CNT; i++)
+    check_block (i);
+  msg ("allocated %d blocks of 1 to 12288 bytes.", BLOCK_CNT);
+
+  for (i = 0; i < BLOCK_CNT; i += 7)
+    {
+      size_t old_size = sizes[i];
+
+      sizes[i] = old_size + old_size / 2 + 1;
+      blocks[i] = realloc (blocks[i], sizes[i]);
+      if (blocks[i] == NULL)
+        fail ("realloc to %zu bytes failed", sizes[i]);
+      for (; old_size < sizes[i]; old_size++)
+        blocks[i][old_size] = i;
+    }
+  for (i = 0; i < BLOCK_CNT; i++)
+    check_block (i);
+  msg ("grew some blocks with realloc().");
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    order[i] = i;
+  for (i = BLOCK_CNT - 1; i > 0; i--)
+    {
+      int j = random_ulong () % (i + 1);
+      int t = order[i];
+      order[i] = order[j];
+      order[j] = t;
+    }
+  for (i = 0; i < BLOCK_CNT; i++)
+    {
+      check_block (order[i]);
+      free (blocks[order[i]]);
+    }
+  msg ("freed all blocks.");
+}
+
+/* Checks that block I still holds its own fill byte. */
+static void
+check_block (int i)
+{
+  size_t j;
+
+  for (j = 0; j < sizes[i]; j++)
+    if (blocks[i][j] != (uint8_t) i)
+      fail ("block %d, of %zu bytes, overwritten at byte %zu",
+            i, sizes[i], j);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-classes) begin
+(malloc-classes) allocated 200 blocks of 1 to 12288 bytes.
+(malloc-classes) grew some blocks with realloc().
+(malloc-classes) freed all blocks.
+(malloc-classes) end
+EOF
+pass;
@@ -0,0 +1,97 @@
+/* Checks that the cost of a timer tick under the advanced
+   scheduler does not grow with the number of blocked threads.
+
+   The main thread creates 10, then 100, then 1000 threads that
+   block on a semaphore.  With each population it counts how many
+   iterations of a busy loop it completes over 4 seconds of
+   timer ticks.  Time spent in the timer interrupt is time the
+   loop does not run, so if the per-tick or per-second
+   bookkeeping walked every thread, the loop count would drop as
+   the population grows.  The test reports each count relative to
+   the count with 10 threads, without failing on any threshold,
+   since the counts depend on the speed of the host and the
+   emulator.
+
+   Needs enough memory for 1000 thread pages. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ROUND_CNT 3
+#define MEASURE_TICKS (4 * TIMER_FREQ)
+
+static const int thread_cnts[ROUND_CNT] = {10, 100, 1000};
+
+static void blocked_thread (void *aux);
+static int64_t count_loops (void);
+
+void
+test_mlfqs_tick_cost (void) 
+{
+  struct semaphore wait_sema, done_sema;
+  int64_t loops[ROUND_CNT];
+  int created = 0;
+  int round;
+  int i;
+
+  ASSERT (thread_mlfqs);
+
+  sema_init (&wait_sema, 0);
+  sema_init (&done_sema, 0);
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      msg ("Measuring tick cost with %d blocked threads...",
+           thread_cnts[round]);
+      for (; created < thread_cnts[round]; created++)
+        {
+          char name[16];
+          snprintf (name, sizeof name, "blk %d", created);
+          if (thread_create (name, PRI_DEFAULT, blocked_thread,
+                             &wait_sema) == TID_ERROR)
+            fail ("could not create thread %d", created);
+        }
+
+      /* Let the new threads run up to their sema_down(). */
+      timer_sleep (TIMER_FREQ);
+      loops[round] = count_loops ();
+    }
+
+  for (i = 0; i < created; i++)
+    sema_up (&wait_sema);
+  timer_sleep (TIMER_FREQ);
+
+  if (loops[0] == 0)
+    fail ("no loops ran with %d threads", thread_cnts[0]);
+  for (round = 0; round < ROUND_CNT; round++)
+    msg ("%d threads: %"PRId64" loops, %"PRId64"%% of %d threads.",
+         thread_cnts[round], loops[round], loops[round] * 100 / loops[0],
+         thread_cnts[0]);
+}
+
+static void
+blocked_thread (void *wait_sema_) 
+{
+  struct semaphore *wait_sema = wait_sema_;
+  sema_down (wait_sema);
+}
+
+/* Spins for MEASURE_TICKS timer ticks, starting at a tick
+   boundary, and returns the number of loop iterations run. */
+static int64_t
+count_loops (void) 
+{
+  int64_t start = timer_ticks ();
+  int64_t loops = 0;
+
+  while (timer_ticks () == start)
+    continue;
+  start = timer_ticks ();
+  while (timer_elapsed (start) < MEASURE_TICKS)
+    loops++;
+  return loops;
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+# The loop counts depend on the host and the emulator, so they are
+# only reported, not compared with a threshold.
+@output = get_core_output ("run", @output);
+my ($t) = qr/^\(mlfqs-tick-cost\)/;
+foreach my $cnt (10, 100, 1000) {
+    fail "missing measurement with $cnt threads"
+      unless grep (/$t Measuring tick cost with $cnt blocked threads\.\.\.$/,
+                   @output);
+    fail "missing loop count with $cnt threads"
+      unless grep (/$t $cnt threads: \d+ loops, \d+% of 10 threads\.$/,
+                   @output);
+}
+fail "test did not finish"
+  unless grep (/$t end$/, @output);
+pass;
@@ -0,0 +1,77 @@
+/* Allocates runs of 1 to 6 pages from the page allocator until
+   they take up more than a hundred pages, fills each and checks
+   that none overlaps another, then frees every other run and
+   the rest after.  Freeing must merge the pages back into big
+   blocks, so that the 32 contiguous pages that were available
+   before are available again. */
+
+#include <stdint.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define RUN_CNT 30
+#define BIG_PAGES 32
+
+static size_t run_pages (int i);
+static void check_run (uint8_t *run, int i);
+
+void
+test_palloc_buddy (void) 
+{
+  static uint8_t *runs[RUN_CNT];
+  uint8_t *big;
+  int i;
+
+  big = palloc_get_multiple (0, BIG_PAGES);
+  if (big == NULL)
+    fail ("no block of %d pages to start with", BIG_PAGES);
+  palloc_free_multiple (big, BIG_PAGES);
+
+  for (i = 0; i < RUN_CNT; i++)
+    {
+      runs[i] = palloc_get_multiple (0, run_pages (i));
+      if (runs[i] == NULL)
+        fail ("allocating %zu pages failed", run_pages (i));
+      memset (runs[i], i, run_pages (i) * PGSIZE);
+    }
+  for (i = 0; i < RUN_CNT; i++)
+    check_run (runs[i], i);
+  msg ("allocated %d runs of 1 to 6 pages.", RUN_CNT);
+
+  for (i = 1; i < RUN_CNT; i += 2)
+    palloc_free_multiple (runs[i], run_pages (i));
+  for (i = 0; i < RUN_CNT; i += 2)
+    check_run (runs[i], i);
+  for (i = 0; i < RUN_CNT; i += 2)
+    palloc_free_multiple (runs[i], run_pages (i));
+  msg ("freed every other run, then the rest.");
+
+  big = palloc_get_multiple (PAL_ZERO, BIG_PAGES);
+  if (big == NULL)
+    fail ("freed pages did not merge into %d contiguous pages", BIG_PAGES);
+  for (i = 0; i < BIG_PAGES * PGSIZE; i++)
+    if (big[i] != 0)
+      fail ("byte %d of a zeroed block is %d", i, big[i]);
+  palloc_free_multiple (big, BIG_PAGES);
+  msg ("allocated %d contiguous pages again.", BIG_PAGES);
+}
+
+/* Returns the number of pages in run I. */
+static size_t
+run_pages (int i)
+{
+  return i % 6 + 1;
+}
+
+/* Checks that run I, at RUN, still holds its own fill byte. */
+static void
+check_run (uint8_t *run, int i)
+{
+  size_t j;
+
+  for (j = 0; j < run_pages (i) * PGSIZE; j++)
+    if (run[j] != (uint8_t) i)
+      fail ("run %d overlaps another", i);
+}
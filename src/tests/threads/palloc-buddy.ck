@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-buddy) begin
+(palloc-buddy) allocated 30 runs of 1 to 6 pages.
+(palloc-buddy) freed every other run, then the rest.
+(palloc-buddy) allocated 32 contiguous pages again.
+(palloc-buddy) end
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Allocates single pages with PAL_ZERO, dirties and frees them,
+   then sleeps so that the pages zeroed in advance are refilled,
+   and allocates them again.  Every page must come back zeroed,
+   whether it was zeroed in advance, whose free list element must
+   be cleared too, or on demand. */
+
+#include <stdint.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define PAGE_CNT 40
+
+static void get_zeroed_pages (int round);
+
+void
+test_palloc_zero (void) 
+{
+  get_zeroed_pages (1);
+  timer_msleep (100);
+  get_zeroed_pages (2);
+}
+
+/* Allocates PAGE_CNT pages with PAL_ZERO, checks that they are
+   zeroed, then fills them and frees them. */
+static void
+get_zeroed_pages (int round)
+{
+  static uint8_t *pages[PAGE_CNT];
+  int i, j;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      pages[i] = palloc_get_page (PAL_ZERO);
+      if (pages[i] == NULL)
+        fail ("allocating page %d failed", i);
+      for (j = 0; j < PGSIZE; j++)
+        if (pages[i][j] != 0)
+          fail ("byte %d of page %d is %d", j, i, pages[i][j]);
+      memset (pages[i], 0x5a, PGSIZE);
+    }
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+  msg ("round %d: %d pages were zeroed.", round, PAGE_CNT);
+}
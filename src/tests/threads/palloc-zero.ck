@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) round 1: 40 pages were zeroed.
+(palloc-zero) round 2: 40 pages were zeroed.
+(palloc-zero) end
+EOF
+pass;
@@ -0,0 +1,44 @@
+/* Tests that threads waiting on a semaphore wake up in order of
+   priority, and in the order they started waiting among threads
+   of the same priority. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func priority_sema_fifo_thread;
+static struct semaphore sema;
+
+void
+test_priority_sema_fifo (void) 
+{
+  int i;
+  
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&sema, 0);
+  thread_set_priority (PRI_MIN);
+  for (i = 0; i < 8; i++) 
+    {
+      int priority = PRI_DEFAULT - 1 - i % 2;
+      char name[16];
+      snprintf (name, sizeof name, "thread %d", i);
+      thread_create (name, priority, priority_sema_fifo_thread, NULL);
+    }
+
+  for (i = 0; i < 8; i++) 
+    {
+      sema_up (&sema);
+      msg ("Back in main thread."); 
+    }
+}
+
+static void
+priority_sema_fifo_thread (void *aux UNUSED) 
+{
+  sema_down (&sema);
+  msg ("%s (priority %d) woke up.", thread_name (), thread_get_priority ());
+}
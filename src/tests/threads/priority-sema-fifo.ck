@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-sema-fifo) begin
+(priority-sema-fifo) thread 0 (priority 30) woke up.
+(priority-sema-fifo) Back in main thread.
+(priority-sema-fifo) thread 2 (priority 30) woke up.
+(priority-sema-fifo) Back in main thread.
+(priority-sema-fifo) thread 4 (priority 30) woke up.
+(priority-sema-fifo) Back in main thread.
+(priority-sema-fifo) thread 6 (priority 30) woke up.
+(priority-sema-fifo) Back in main thread.
+(priority-sema-fifo) thread 1 (priority 29) woke up.
+(priority-sema-fifo) Back in main thread.
+(priority-sema-fifo) thread 3 (priority 29) woke up.
+(priority-sema-fifo) Back in main thread.
+(priority-sema-fifo) thread 5 (priority 29) woke up.
+(priority-sema-fifo) Back in main thread.
+(priority-sema-fifo) thread 7 (priority 29) woke up.
+(priority-sema-fifo) Back in main thread.
+(priority-sema-fifo) end
+EOF
+pass;
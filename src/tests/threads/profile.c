@@ -0,0 +1,22 @@
+/* Spins for 50 timer ticks under -profile=1, so that the profile
+   printed at shutdown holds at least 50 samples of the kernel,
+   and none of user programs. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/profile.h"
+#include "devices/timer.h"
+
+void
+test_profile (void) 
+{
+  int64_t start;
+
+  ASSERT (profile_interval == 1);
+
+  start = timer_ticks ();
+  while (timer_elapsed (start) < 50)
+    continue;
+  msg ("Spun for 50 ticks.");
+}
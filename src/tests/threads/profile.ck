@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+check_expected ([<<'EOF']);
+(profile) begin
+(profile) Spun for 50 ticks.
+(profile) end
+EOF
+
+my ($samples) = map (/^Profile: (\d+) samples, one every 1 timer/, @output);
+fail "missing profile summary in output" unless defined $samples;
+fail "only $samples samples in 50 ticks" if $samples < 50;
+fail "no kernel addresses in profile"
+  unless grep (/^Profile kernel: +\d+ +\d+  0x[0-9a-f]+$/, @output)
+    && grep (/^Profile kernel addresses:( 0x[0-9a-f]+)+$/, @output);
+fail "user addresses in profile of a kernel test"
+  unless grep (/^Profile user addresses:$/, @output);
+
+pass;
@@ -0,0 +1,116 @@
+/* Compares the throughput of a reader-writer lock with that of a
+   plain lock for a read-mostly workload.
+
+   THREAD_CNT threads each run SECTION_CNT read-side critical
+   sections, once under a lock and once under a reader-writer
+   lock held for reading.  Every section sleeps for a tick, as a
+   lookup that has to wait for the disk would.  Under the lock
+   the sections run one at a time, while under the reader-writer
+   lock the readers sleep side by side, so the second run must
+   take a fraction of the ticks of the first.  The check is done
+   by rwlock-bench.ck.
+
+   The test also reports what an uncontended acquire and release
+   costs for either lock. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 8
+#define SECTION_CNT 5
+#define UNCONTENDED_CNT 10000
+
+static struct lock lock;
+static struct rwlock rwlock;
+static struct semaphore done_sema;
+
+static thread_func lock_reader;
+static thread_func rwlock_reader;
+static void run_readers (const char *kind, thread_func *);
+
+void
+test_rwlock_bench (void) 
+{
+  int64_t start;
+  int i;
+
+  lock_init (&lock);
+  rwlock_init (&rwlock);
+  sema_init (&done_sema, 0);
+
+  run_readers ("lock", lock_reader);
+  run_readers ("rwlock", rwlock_reader);
+
+  start = timer_ns ();
+  for (i = 0; i < UNCONTENDED_CNT; i++)
+    {
+      lock_acquire (&lock);
+      lock_release (&lock);
+    }
+  msg ("uncontended lock: %"PRId64" ns per section.",
+       (timer_ns () - start) / UNCONTENDED_CNT);
+
+  start = timer_ns ();
+  for (i = 0; i < UNCONTENDED_CNT; i++)
+    {
+      rwlock_read_acquire (&rwlock);
+      rwlock_read_release (&rwlock);
+    }
+  msg ("uncontended rwlock: %"PRId64" ns per section.",
+       (timer_ns () - start) / UNCONTENDED_CNT);
+}
+
+/* Runs THREAD_CNT threads executing FUNC and reports how many
+   ticks they took to complete all their sections. */
+static void
+run_readers (const char *kind, thread_func *func) 
+{
+  int64_t start = timer_ticks ();
+  int64_t ticks;
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "%s %d", kind, i);
+      thread_create (name, PRI_DEFAULT, func, NULL);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done_sema);
+  ticks = timer_elapsed (start);
+  msg ("%s: %d sections in %"PRId64" ticks.",
+       kind, THREAD_CNT * SECTION_CNT, ticks);
+}
+
+static void
+lock_reader (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < SECTION_CNT; i++)
+    {
+      lock_acquire (&lock);
+      timer_sleep (1);
+      lock_release (&lock);
+    }
+  sema_up (&done_sema);
+}
+
+static void
+rwlock_reader (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < SECTION_CNT; i++)
+    {
+      rwlock_read_acquire (&rwlock);
+      timer_sleep (1);
+      rwlock_read_release (&rwlock);
+    }
+  sema_up (&done_sema);
+}
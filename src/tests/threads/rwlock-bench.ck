@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+my (%ticks);
+foreach (@output) {
+    $ticks{$1} = $2 if /^\(rwlock-bench\) (lock|rwlock): 40 sections in (\d+) ticks\.$/;
+}
+fail "missing lock timing in output" unless defined $ticks{'lock'};
+fail "missing rwlock timing in output" unless defined $ticks{'rwlock'};
+fail "readers took $ticks{'rwlock'} ticks under the rwlock, "
+  . "but $ticks{'lock'} ticks under a lock"
+  if $ticks{'rwlock'} * 4 > $ticks{'lock'};
+fail "missing uncontended costs in output"
+  unless grep (/^\(rwlock-bench\) uncontended rwlock: \d+ ns per section\.$/,
+               @output);
+
+pass;
@@ -0,0 +1,60 @@
+/* The main thread acquires a reader-writer lock for writing.
+   Then it creates a higher-priority reader and an even
+   higher-priority writer, which both block and donate their
+   priorities to the main thread.  When the main thread releases
+   the lock, the writer and then the reader should get it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_donate (void) 
+{
+  struct rwlock rwlock;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  rwlock_write_acquire (&rwlock);
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread_func, &rwlock);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 1, thread_get_priority ());
+  thread_create ("writer", PRI_DEFAULT + 2, writer_thread_func, &rwlock);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 2, thread_get_priority ());
+  rwlock_write_release (&rwlock);
+  msg ("writer, reader must already have finished, in that order.");
+  msg ("This should be the last line before finishing this test.");
+}
+
+static void
+reader_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_read_acquire (rwlock);
+  msg ("reader: got the lock");
+  rwlock_read_release (rwlock);
+  msg ("reader: done");
+}
+
+static void
+writer_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_write_acquire (rwlock);
+  msg ("writer: got the lock");
+  rwlock_write_release (rwlock);
+  msg ("writer: done");
+}
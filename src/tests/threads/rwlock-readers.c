@@ -0,0 +1,57 @@
+/* The main thread acquires a reader-writer lock for reading and
+   creates three higher-priority readers, which must get the lock
+   for reading at once.  Then it creates a higher-priority writer,
+   which must wait until the main thread stops reading. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_readers (void) 
+{
+  struct rwlock rwlock;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&rwlock);
+  rwlock_read_acquire (&rwlock);
+  for (i = 0; i < 3; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT + 1, reader_thread_func, &rwlock);
+    }
+  msg ("Main thread still reading.");
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func, &rwlock);
+  msg ("Writer must wait for the main thread to stop reading.");
+  rwlock_read_release (&rwlock);
+  msg ("Writer must already have finished.");
+}
+
+static void
+reader_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_read_acquire (rwlock);
+  msg ("%s: reading", thread_name ());
+  rwlock_read_release (rwlock);
+}
+
+static void
+writer_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_write_acquire (rwlock);
+  msg ("writer: writing");
+  rwlock_write_release (rwlock);
+}
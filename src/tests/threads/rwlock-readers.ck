@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-readers) begin
+(rwlock-readers) reader 0: reading
+(rwlock-readers) reader 1: reading
+(rwlock-readers) reader 2: reading
+(rwlock-readers) Main thread still reading.
+(rwlock-readers) Writer must wait for the main thread to stop reading.
+(rwlock-readers) writer: writing
+(rwlock-readers) Writer must already have finished.
+(rwlock-readers) end
+EOF
+pass;
@@ -0,0 +1,58 @@
+/* The main thread acquires a reader-writer lock for reading.  It
+   creates a writer of priority PRI_DEFAULT + 1, which waits for
+   the main thread to stop reading, and then a reader of priority
+   PRI_DEFAULT + 2.  Writers have preference, so the new reader
+   must wait behind the writer instead of joining the main
+   thread, and donate its priority to the writer.  When the main
+   thread stops reading, the writer writes at the donated
+   priority, then the reader reads. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_writer_pref (void) 
+{
+  struct rwlock rwlock;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  rwlock_read_acquire (&rwlock);
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func, &rwlock);
+  thread_create ("reader", PRI_DEFAULT + 2, reader_thread_func, &rwlock);
+  msg ("Reader must be waiting behind the writer.");
+  rwlock_read_release (&rwlock);
+  msg ("Writer, then reader, must already have finished.");
+}
+
+static void
+reader_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_read_acquire (rwlock);
+  msg ("reader: reading");
+  rwlock_read_release (rwlock);
+}
+
+static void
+writer_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_write_acquire (rwlock);
+  msg ("writer: writing.  This thread should have priority %d.  "
+       "Actual priority: %d.", PRI_DEFAULT + 2, thread_get_priority ());
+  rwlock_write_release (rwlock);
+}
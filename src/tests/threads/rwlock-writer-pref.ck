@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer-pref) begin
+(rwlock-writer-pref) Reader must be waiting behind the writer.
+(rwlock-writer-pref) writer: writing.  This thread should have priority 33.  Actual priority: 33.
+(rwlock-writer-pref) reader: reading
+(rwlock-writer-pref) Writer, then reader, must already have finished.
+(rwlock-writer-pref) end
+EOF
+pass;
@@ -0,0 +1,93 @@
+/* Allocates enough objects from an object cache to fill a few
+   slabs, and checks that they are distinct, aligned, and were
+   each constructed exactly once, when their slab was created.
+   Frees them all, which must leave a single empty slab, then
+   allocates again and checks that the constructed objects are
+   reused without running the constructor again. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+
+#define OBJ_CNT 50
+#define OBJ_MAGIC 0x0b1ec7
+
+/* An object: 200 bytes, which malloc() would round up to 256. */
+struct obj
+  {
+    int magic;                  /* Set by the constructor. */
+    int id;                     /* Owner while allocated. */
+    char data[192];
+  };
+
+static struct kmem_cache cache;
+static int ctor_cnt;
+
+static kmem_ctor obj_ctor;
+
+void
+test_slab (void) 
+{
+  static struct obj *objs[OBJ_CNT];
+  size_t slab_cnt;
+  int i, j;
+
+  kmem_cache_create (&cache, "test", sizeof (struct obj), obj_ctor);
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      struct obj *o = objs[i] = kmem_cache_alloc (&cache);
+      if (o == NULL)
+        fail ("allocation %d failed", i);
+      if ((uintptr_t) o % 8 != 0)
+        fail ("object %d is misaligned", i);
+      if (pg_ofs (o) + sizeof *o > PGSIZE)
+        fail ("object %d crosses a page boundary", i);
+      if (o->magic != OBJ_MAGIC)
+        fail ("object %d was not constructed", i);
+      o->id = i;
+      memset (o->data, i, sizeof o->data);
+    }
+  msg ("allocated %d objects.", OBJ_CNT);
+
+  for (i = 0; i < OBJ_CNT; i++)
+    for (j = 0; j < (int) sizeof objs[i]->data; j++)
+      if (objs[i]->id != i || objs[i]->data[j] != (char) i)
+        fail ("object %d overlaps another", i);
+  slab_cnt = cache.slab_cnt;
+  if (slab_cnt < 2 || cache.used_cnt != OBJ_CNT)
+    fail ("%zu objects in %zu slabs", cache.used_cnt, slab_cnt);
+  if (ctor_cnt != (int) (slab_cnt * cache.obj_cnt))
+    fail ("constructor ran %d times for %zu slabs of %zu objects",
+          ctor_cnt, slab_cnt, cache.obj_cnt);
+  msg ("each object was constructed once.");
+
+  for (i = OBJ_CNT - 1; i >= 0; i--)
+    kmem_cache_free (&cache, objs[i]);
+  if (cache.used_cnt != 0 || cache.slab_cnt != 1)
+    fail ("%zu objects in %zu slabs after freeing all", cache.used_cnt,
+          cache.slab_cnt);
+  msg ("freed all objects, one empty slab kept.");
+
+  ctor_cnt = 0;
+  for (i = 0; i < OBJ_CNT; i++)
+    objs[i] = kmem_cache_alloc (&cache);
+  if (ctor_cnt != (int) ((cache.slab_cnt - 1) * cache.obj_cnt))
+    fail ("constructor ran %d times for %zu new slabs", ctor_cnt,
+          cache.slab_cnt - 1);
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (&cache, objs[i]);
+  msg ("the empty slab was reused.");
+}
+
+static void
+obj_ctor (void *o_) 
+{
+  struct obj *o = o_;
+
+  o->magic = OBJ_MAGIC;
+  ctor_cnt++;
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab) begin
+(slab) allocated 50 objects.
+(slab) each object was constructed once.
+(slab) freed all objects, one empty slab kept.
+(slab) the empty slab was reused.
+(slab) end
+EOF
+pass;
@@ -22,7 +22,28 @@ static const struct test tests[] =
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
+    {"priority-sema-fifo", test_priority_sema_fifo},
     {"priority-condvar", test_priority_condvar},
+    {"alarm-wheel", test_alarm_wheel},
+    {"alarm-usleep", test_alarm_usleep},
+    {"edf-deadline", test_edf_deadline},
+    {"edf-deadline-tickless", test_edf_deadline_tickless},
+    {"thread-recycle", test_thread_recycle},
+    {"lockstat", test_lockstat},
+    {"rwlock-readers", test_rwlock_readers},
+    {"rwlock-writer-pref", test_rwlock_writer_pref},
+    {"rwlock-donate", test_rwlock_donate},
+    {"rwlock-bench", test_rwlock_bench},
+    {"workqueue", test_workqueue},
+    {"profile", test_profile},
+    {"trace", test_trace},
+    {"irqsoff", test_irqsoff},
+    {"intr-stats", test_intr_stats},
+    {"slab", test_slab},
+    {"malloc-classes", test_malloc_classes},
+    {"palloc-buddy", test_palloc_buddy},
+    {"palloc-zero", test_palloc_zero},
+    {"malloc-bench", test_malloc_bench},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -32,6 +53,11 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"mlfqs-tick-cost", test_mlfqs_tick_cost},
+    {"cfs-fair-2", test_cfs_fair_2},
+    {"cfs-fair-20", test_cfs_fair_20},
+    {"cfs-nice-2", test_cfs_nice_2},
+    {"cfs-nice-10", test_cfs_nice_10},
   };
 
 static const char *test_name;
@@ -16,7 +16,28 @@ extern test_func test_priority_donate_chain;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
+extern test_func test_priority_sema_fifo;
 extern test_func test_priority_condvar;
+extern test_func test_alarm_wheel;
+extern test_func test_alarm_usleep;
+extern test_func test_edf_deadline;
+extern test_func test_edf_deadline_tickless;
+extern test_func test_thread_recycle;
+extern test_func test_lockstat;
+extern test_func test_rwlock_readers;
+extern test_func test_rwlock_writer_pref;
+extern test_func test_rwlock_donate;
+extern test_func test_rwlock_bench;
+extern test_func test_workqueue;
+extern test_func test_profile;
+extern test_func test_trace;
+extern test_func test_irqsoff;
+extern test_func test_intr_stats;
+extern test_func test_slab;
+extern test_func test_malloc_classes;
+extern test_func test_palloc_buddy;
+extern test_func test_palloc_zero;
+extern test_func test_malloc_bench;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -26,6 +47,11 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_mlfqs_tick_cost;
+extern test_func test_cfs_fair_2;
+extern test_func test_cfs_fair_20;
+extern test_func test_cfs_nice_2;
+extern test_func test_cfs_nice_10;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,65 @@
+/* Creates many short-lived threads in bursts, so that most of
+   them run on the page of a thread that exited shortly before,
+   and checks that each one starts with a clean struct thread and
+   runs exactly once.
+
+   More threads are created in total than there are pages in the
+   kernel pool, so pages must also find their way back to the
+   page allocator. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define ROUND_CNT 20
+#define THREAD_CNT 250
+
+static struct semaphore done_sema;
+static int runs[THREAD_CNT];
+
+static void worker_thread (void *);
+
+void
+test_thread_recycle (void) 
+{
+  int round, i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done_sema, 0);
+
+  msg ("Running %d rounds of %d threads...", ROUND_CNT, THREAD_CNT);
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      for (i = 0; i < THREAD_CNT; i++) 
+        {
+          char name[16];
+          snprintf (name, sizeof name, "worker %d", i);
+          if (thread_create (name, PRI_DEFAULT, worker_thread, &runs[i])
+              == TID_ERROR)
+            fail ("thread_create failed in round %d", round);
+        }
+      for (i = 0; i < THREAD_CNT; i++)
+        sema_down (&done_sema);
+    }
+
+  for (i = 0; i < THREAD_CNT; i++)
+    if (runs[i] != ROUND_CNT)
+      fail ("worker %d ran %d times instead of %d", i, runs[i], ROUND_CNT);
+  msg ("Every thread ran once per round.");
+}
+
+static void
+worker_thread (void *runs_) 
+{
+  int *runs = runs_;
+  struct thread *t = thread_current ();
+
+  if (thread_get_nice () != 0 || t->b_edf || t->b_sleeping)
+    fail ("thread started with stale state");
+  (*runs)++;
+  sema_up (&done_sema);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-recycle) begin
+(thread-recycle) Running 20 rounds of 250 threads...
+(thread-recycle) Every thread ran once per round.
+(thread-recycle) end
+EOF
+pass;
@@ -0,0 +1,42 @@
+/* Runs a few threads that block, unblock and contend for a lock
+   under -trace.  A kernel without a file system has nowhere to
+   save the trace, so it only reports how many events it
+   recorded at shutdown, which must not be none. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/trace.h"
+#include "devices/timer.h"
+
+static thread_func trace_thread;
+static struct lock lock;
+
+void
+test_trace (void) 
+{
+  int i;
+
+  ASSERT (trace_enabled);
+
+  lock_init (&lock);
+  lock_acquire (&lock);
+  for (i = 0; i < 3; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "thread %d", i);
+      thread_create (name, PRI_DEFAULT + 1, trace_thread, NULL);
+    }
+  timer_sleep (2);
+  lock_release (&lock);
+  msg ("Threads acquired the lock in turn.");
+}
+
+static void
+trace_thread (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  lock_release (&lock);
+}
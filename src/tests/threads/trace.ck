@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+check_expected ([<<'EOF']);
+(trace) begin
+(trace) Threads acquired the lock in turn.
+(trace) end
+EOF
+
+my ($events) = map (/^Trace: (\d+) events not saved: no scratch device\.$/,
+                    @output);
+fail "missing trace summary in output" unless defined $events;
+fail "no events traced" if $events == 0;
+
+pass;
@@ -0,0 +1,66 @@
+/* Queues work items of mixed priorities on a workqueue whose
+   worker has a lower priority than the main thread, so that
+   none of them runs before the main thread blocks.  The worker
+   must then run them highest priority first, and in the order
+   they were queued among items of the same priority.  Queuing
+   an item that is already pending must fail, while an item may
+   queue itself again once it runs. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+#define ITEM_CNT 5
+
+static struct workqueue wq;
+static struct semaphore done;
+static struct work items[ITEM_CNT];
+
+static work_func item_func;
+
+void
+test_workqueue (void) 
+{
+  static const int priorities[ITEM_CNT] = {10, 40, 20, 40, 5};
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&done, 0);
+  workqueue_create (&wq, "worker", PRI_DEFAULT - 1);
+  for (i = 0; i < ITEM_CNT; i++)
+    {
+      work_init (&items[i], item_func, items + i, priorities[i]);
+      workqueue_queue (&wq, &items[i]);
+    }
+  msg ("Queuing item 1 again %s.",
+       workqueue_queue (&wq, &items[1]) ? "succeeded" : "failed");
+  msg ("Items must run in order 1, 3, 2, 0, 4, 4.");
+
+  for (i = 0; i < ITEM_CNT + 1; i++)
+    sema_down (&done);
+  msg ("All items ran.");
+}
+
+static void
+item_func (void *w_) 
+{
+  struct work *w = w_;
+  static bool requeued;
+
+  msg ("item %d (priority %d) runs.", (int) (w - items), w->priority);
+  if (w == &items[ITEM_CNT - 1] && !requeued)
+    {
+      requeued = true;
+      if (!workqueue_queue (&wq, w))
+        fail ("could not queue item %d from itself", (int) (w - items));
+    }
+  sema_up (&done);
+}
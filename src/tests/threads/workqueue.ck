@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) Queuing item 1 again failed.
+(workqueue) Items must run in order 1, 3, 2, 0, 4, 4.
+(workqueue) item 1 (priority 40) runs.
+(workqueue) item 3 (priority 40) runs.
+(workqueue) item 2 (priority 20) runs.
+(workqueue) item 0 (priority 10) runs.
+(workqueue) item 4 (priority 5) runs.
+(workqueue) item 4 (priority 5) runs.
+(workqueue) All items ran.
+(workqueue) end
+EOF
+pass;
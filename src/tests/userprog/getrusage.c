@@ -0,0 +1,37 @@
+/* Checks the scheduler accounting returned by getrusage: run
+   time grows while the process computes, waiting for a child
+   counts as a voluntary context switch, and none of the
+   counters go backwards.  Finally passes a kernel address,
+   which must terminate the process with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct rusage before, after;
+  volatile int i;
+
+  getrusage (&before);
+  for (i = 0; i < 1000000; i++)
+    continue;
+  getrusage (&after);
+  CHECK (after.run_us > before.run_us, "run time grows while computing");
+
+  before = after;
+  CHECK (wait (exec ("child-simple")) == 81, "wait(exec())");
+  getrusage (&after);
+  CHECK (after.voluntary_switches > before.voluntary_switches,
+         "waiting is a voluntary switch");
+  CHECK (after.run_us >= before.run_us
+         && after.wait_us >= before.wait_us
+         && after.lock_wait_us >= before.lock_wait_us
+         && after.involuntary_switches >= before.involuntary_switches
+         && after.lock_blocks >= before.lock_blocks,
+         "counters do not go backwards");
+
+  getrusage ((struct rusage *) 0xc0000000);
+  fail ("should have exited with -1");
+}
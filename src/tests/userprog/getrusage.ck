@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(getrusage) begin
+(getrusage) run time grows while computing
+(getrusage) wait(exec())
+(child-simple) run
+child-simple: exit(81)
+(getrusage) waiting is a voluntary switch
+(getrusage) counters do not go backwards
+getrusage: exit(-1)
+EOF
+pass;
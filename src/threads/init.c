@@ -20,7 +20,9 @@
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
+#include "threads/trace.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -98,6 +100,8 @@ main (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+  profile_init ();
+  trace_init ();
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -117,6 +121,7 @@ main (void)
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
+  palloc_start_zeroing ();
   serial_init_queue ();
   timer_calibrate ();
 
@@ -256,6 +261,27 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-cfs"))
+        thread_cfs = true;
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
+      else if (!strcmp (name, "-lockstat"))
+        synch_lockstat = true;
+      else if (!strcmp (name, "-profile"))
+        {
+          int interval = value != NULL ? atoi (value) : 0;
+          if (interval <= 0)
+            PANIC ("-profile needs a positive interval (use -h for help)");
+          profile_interval = interval;
+        }
+      else if (!strcmp (name, "-trace"))
+        trace_enabled = true;
+      else if (!strcmp (name, "-irqsoff"))
+        {
+          intr_irqsoff = value != NULL ? atoi (value) : 10;
+          if (intr_irqsoff <= 0)
+            PANIC ("-irqsoff needs a positive count (use -h for help)");
+        }
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -379,6 +405,12 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -cfs               Use completely fair scheduler.\n"
+          "  -tickless          Stop the timer tick while the CPU is idle.\n"
+          "  -lockstat          Gather contention statistics of kernel locks.\n"
+          "  -profile=N         Sample the running code every N timer interrupts.\n"
+          "  -trace             Record kernel events to the scratch device.\n"
+          "  -irqsoff[=N]       Report the N (10) longest interrupts-off sections.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
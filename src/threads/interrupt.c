@@ -3,6 +3,7 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
@@ -47,6 +48,68 @@ static unsigned int unexpected_cnt[INTR_CNT];
 static bool in_external_intr;   /* Are we processing an external interrupt? */
 static bool yield_on_return;    /* Should we yield on interrupt return? */
 
+/* Statistics of the handlers of the external interrupts, 0x20
+   to 0x2f, and of the system call gate, 0x30.  Handler times are
+   measured with the TSC.  A system call may block, so its time
+   is the time its thread spent on the CPU, as accounted by the
+   scheduler, rather than the time until it returned.  The
+   histogram has a bucket for handlers that took less than 1 us,
+   then one per power of 2 of microseconds, the last one taking
+   everything longer. */
+#define STATS_VEC_MIN 0x20
+#define STATS_VEC_MAX 0x30
+#define HISTOGRAM_BUCKETS 20
+
+struct intr_stats
+  {
+    unsigned cnt;               /* Calls to the handler that returned. */
+    uint64_t total;             /* Time in the handler, in TSC cycles. */
+    uint64_t longest;           /* Longest call, in TSC cycles. */
+    unsigned histogram[HISTOGRAM_BUCKETS]; /* Calls by log2 of time. */
+  };
+static struct intr_stats intr_stats[STATS_VEC_MAX - STATS_VEC_MIN + 1];
+static uint32_t cycles_per_us;  /* TSC cycles per microsecond, once known. */
+
+/* Interrupts-off latency tracer.  With -irqsoff, each stretch of
+   code that runs with interrupts off, from the intr_disable() or
+   intr_set_level() call that turns them off to the one that
+   turns them back on, possibly in another thread, is timed with
+   the TSC.  The sections are grouped by the place that turned
+   interrupts off, and the places with the longest sections are
+   printed at shutdown. */
+#define IRQSOFF_SITE_CNT 128    /* Power of 2. */
+#define IRQSOFF_PROBE_MAX 8
+
+/* Sections of code that start at the same place. */
+struct irqsoff_site
+  {
+    void *disabled_at;          /* Caller that turned interrupts off. */
+    void *enabled_at;           /* Caller that turned them back on,
+                                   at the end of the longest section. */
+    unsigned cnt;               /* Number of sections, 0 if unused. */
+    uint64_t total;             /* Total time, in TSC cycles. */
+    uint64_t longest;           /* Longest section, in TSC cycles. */
+  };
+
+/* Number of places to print, or 0 if not tracing. */
+int intr_irqsoff;
+
+static struct irqsoff_site irqsoff_sites[IRQSOFF_SITE_CNT];
+static unsigned irqsoff_dropped_cnt;   /* Sections that found no site. */
+static void *irqsoff_disabled_at;      /* Start of the current section,
+                                          or NULL if none is timed. */
+static uint64_t irqsoff_start;         /* TSC at that start. */
+
+static uint64_t intr_stats_clock (uint8_t vec_no);
+static void intr_stats_account (uint8_t vec_no, uint64_t cycles);
+static void print_handler_stats (void);
+static void print_irqsoff_stats (void);
+static enum intr_level disable (void *caller);
+static enum intr_level enable (void *caller);
+static void irqsoff_end (void *enabled_at);
+static int compare_irqsoff_sites (const void *, const void *);
+static uint64_t cycles_to_us (uint64_t cycles);
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
@@ -80,16 +143,35 @@ intr_get_level (void)
 enum intr_level
 intr_set_level (enum intr_level level) 
 {
-  return level == INTR_ON ? intr_enable () : intr_disable ();
+  void *caller = __builtin_return_address (0);
+  return level == INTR_ON ? enable (caller) : disable (caller);
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_enable (void) 
+{
+  return enable (__builtin_return_address (0));
+}
+
+/* Disables interrupts and returns the previous interrupt status. */
+enum intr_level
+intr_disable (void) 
+{
+  return disable (__builtin_return_address (0));
+}
+
+/* Enables interrupts on behalf of CALLER and returns the
+   previous interrupt status. */
+static enum intr_level
+enable (void *caller) 
 {
   enum intr_level old_level = intr_get_level ();
   ASSERT (!intr_context ());
 
+  if (old_level == INTR_OFF && irqsoff_disabled_at != NULL)
+    irqsoff_end (caller);
+
   /* Enable interrupts by setting the interrupt flag.
 
      See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -99,9 +181,10 @@ intr_enable (void)
   return old_level;
 }
 
-/* Disables interrupts and returns the previous interrupt status. */
-enum intr_level
-intr_disable (void) 
+/* Disables interrupts on behalf of CALLER and returns the
+   previous interrupt status. */
+static enum intr_level
+disable (void *caller) 
 {
   enum intr_level old_level = intr_get_level ();
 
@@ -110,6 +193,12 @@ intr_disable (void)
      Hardware Interrupts". */
   asm volatile ("cli" : : : "memory");
 
+  if (old_level == INTR_ON && intr_irqsoff != 0)
+    {
+      irqsoff_disabled_at = caller;
+      irqsoff_start = timer_cycles ();
+    }
+
   return old_level;
 }
 
@@ -352,6 +441,12 @@ intr_handler (struct intr_frame *frame)
      and they need to be acknowledged on the PIC (see below).
      An external interrupt handler cannot sleep. */
   external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+
+  /* Interrupts were on, so any section of code timed by the
+     interrupts-off tracer was left without calling intr_enable(),
+     e.g. by the idle thread's `sti'. */
+  if (frame->eflags & FLAG_IF)
+    irqsoff_disabled_at = NULL;
   if (external) 
     {
       ASSERT (intr_get_level () == INTR_OFF);
@@ -363,7 +458,15 @@ intr_handler (struct intr_frame *frame)
 
   /* Invoke the interrupt's handler. */
   handler = intr_handlers[frame->vec_no];
-  if (handler != NULL)
+  if (handler != NULL
+      && frame->vec_no >= STATS_VEC_MIN && frame->vec_no <= STATS_VEC_MAX)
+    {
+      uint64_t start = intr_stats_clock (frame->vec_no);
+      handler (frame);
+      intr_stats_account (frame->vec_no,
+                          intr_stats_clock (frame->vec_no) - start);
+    }
+  else if (handler != NULL)
     handler (frame);
   else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f)
     {
@@ -388,6 +491,184 @@ intr_handler (struct intr_frame *frame)
     }
 }
 
+/* Ends the section of code with interrupts off that is being
+   timed, at the call from ENABLED_AT that turns them back on.
+   Interrupts must still be off. */
+static void
+irqsoff_end (void *enabled_at)
+{
+  uint64_t cycles = timer_cycles () - irqsoff_start;
+  void *disabled_at = irqsoff_disabled_at;
+  size_t i = (uintptr_t) disabled_at >> 2;
+  int probe;
+
+  irqsoff_disabled_at = NULL;
+  for (probe = 0; probe < IRQSOFF_PROBE_MAX; probe++, i++)
+    {
+      struct irqsoff_site *s = &irqsoff_sites[i & (IRQSOFF_SITE_CNT - 1)];
+      if (s->cnt == 0)
+        s->disabled_at = disabled_at;
+      else if (s->disabled_at != disabled_at)
+        continue;
+
+      s->cnt++;
+      s->total += cycles;
+      if (cycles >= s->longest)
+        {
+          s->longest = cycles;
+          s->enabled_at = enabled_at;
+        }
+      return;
+    }
+  irqsoff_dropped_cnt++;
+}
+
+/* Returns the clock that times the handler of VEC_NO, in TSC
+   cycles: the running thread's time on the CPU for a system
+   call, which may block, and the TSC for an external interrupt,
+   which cannot. */
+static uint64_t
+intr_stats_clock (uint8_t vec_no)
+{
+  return vec_no == 0x30 ? thread_run_cycles () : timer_cycles ();
+}
+
+/* Adds a call of CYCLES to the handler of VEC_NO to its
+   statistics. */
+static void
+intr_stats_account (uint8_t vec_no, uint64_t cycles)
+{
+  struct intr_stats *s = &intr_stats[vec_no - STATS_VEC_MIN];
+  enum intr_level old_level;
+
+  /* System calls run with interrupts on, and may run in several
+     threads at once. */
+  old_level = intr_disable ();
+  s->cnt++;
+  s->total += cycles;
+  if (cycles > s->longest)
+    s->longest = cycles;
+  if (cycles_per_us == 0)
+    cycles_per_us = timer_cycles_per_sec () / 1000000;
+  if (cycles_per_us != 0)
+    {
+      uint32_t us = cycles < UINT32_MAX ? (uint32_t) cycles / cycles_per_us
+                                        : UINT32_MAX;
+      int bucket = us == 0 ? 0 : 32 - __builtin_clz (us);
+      s->histogram[bucket < HISTOGRAM_BUCKETS
+                   ? bucket : HISTOGRAM_BUCKETS - 1]++;
+    }
+  intr_set_level (old_level);
+}
+
+/* Prints interrupt statistics: the calls to the handlers of
+   external interrupts and system calls, and under -irqsoff the
+   places that kept interrupts off the longest. */
+void
+intr_print_stats (void)
+{
+  print_handler_stats ();
+  print_irqsoff_stats ();
+}
+
+/* Prints the number of calls to each handler of an external
+   interrupt or of system calls, the time they took, and their
+   histogram.  Bucket "<N" counts the calls shorter than N us but
+   not shorter than the previous bucket's bound.  System calls
+   that do not return, like exit, are not counted, and calls made
+   before the TSC was calibrated are left out of the histogram. */
+static void
+print_handler_stats (void)
+{
+  int vec_no;
+
+  printf ("Interrupt handlers (times in us):\n");
+  printf ("  %-4s %-16s %9s %10s %8s\n",
+          "vec", "name", "calls", "total", "longest");
+  for (vec_no = STATS_VEC_MIN; vec_no <= STATS_VEC_MAX; vec_no++)
+    {
+      const struct intr_stats *s = &intr_stats[vec_no - STATS_VEC_MIN];
+      int bucket, last;
+
+      if (s->cnt == 0)
+        continue;
+      printf ("  %#04x %-16s %9u %10"PRIu64" %8"PRIu64"\n",
+              vec_no, intr_names[vec_no], s->cnt,
+              cycles_to_us (s->total), cycles_to_us (s->longest));
+
+      for (last = HISTOGRAM_BUCKETS - 1; last >= 0; last--)
+        if (s->histogram[last] != 0)
+          break;
+      if (last < 0)
+        continue;
+      printf ("      ");
+      for (bucket = 0; bucket <= last; bucket++)
+        if (bucket < HISTOGRAM_BUCKETS - 1)
+          printf (" <%u:%u", 1u << bucket, s->histogram[bucket]);
+        else
+          printf (" >=%u:%u", 1u << (bucket - 1), s->histogram[bucket]);
+      printf ("\n");
+    }
+}
+
+/* Prints the places that kept interrupts off the longest, under
+   -irqsoff.  The addresses where each section started and ended
+   are repeated on a line that utils/backtrace accepts as is. */
+static void
+print_irqsoff_stats (void)
+{
+  int top = intr_irqsoff;
+  int i;
+
+  if (top == 0)
+    return;
+
+  /* Stop tracing, since sorting moves the sites around. */
+  intr_irqsoff = 0;
+  irqsoff_disabled_at = NULL;
+  qsort (irqsoff_sites, IRQSOFF_SITE_CNT, sizeof *irqsoff_sites,
+         compare_irqsoff_sites);
+
+  printf ("Interrupts-off sections (times in us), longest first:\n");
+  printf ("  %9s %9s %10s  %-10s  %s\n",
+          "longest", "sections", "total", "disabled", "enabled");
+  for (i = 0; i < top && irqsoff_sites[i].cnt != 0; i++)
+    {
+      const struct irqsoff_site *s = &irqsoff_sites[i];
+      printf ("  %9"PRIu64" %9u %10"PRIu64"  %-10p  %p\n",
+              cycles_to_us (s->longest), s->cnt, cycles_to_us (s->total),
+              s->disabled_at, s->enabled_at);
+    }
+  if (irqsoff_dropped_cnt != 0)
+    printf ("  (%u sections from other places not counted)\n",
+            irqsoff_dropped_cnt);
+
+  printf ("Irqsoff addresses:");
+  for (i = 0; i < top && irqsoff_sites[i].cnt != 0; i++)
+    printf (" %p %p", irqsoff_sites[i].disabled_at,
+            irqsoff_sites[i].enabled_at);
+  printf ("\n");
+}
+
+/* Orders interrupts-off sites by decreasing longest section. */
+static int
+compare_irqsoff_sites (const void *a_, const void *b_)
+{
+  const struct irqsoff_site *a = a_;
+  const struct irqsoff_site *b = b_;
+
+  return a->longest < b->longest ? 1 : a->longest > b->longest ? -1 : 0;
+}
+
+/* Converts CYCLES of the TSC to microseconds, once the TSC has
+   been calibrated. */
+static uint64_t
+cycles_to_us (uint64_t cycles)
+{
+  uint64_t hz = timer_cycles_per_sec ();
+  return hz != 0 ? cycles * 1000000 / hz : 0;
+}
+
 /* Handles an unexpected interrupt with interrupt frame F.  An
    unexpected interrupt is one that has no registered handler. */
 static void
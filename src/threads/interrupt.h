@@ -67,4 +67,9 @@ void intr_yield_on_return (void);
 void intr_dump_frame (const struct intr_frame *);
 const char *intr_name (uint8_t vec);
 
+/* Number of places with the longest interrupts-off sections to
+   print, set by "-irqsoff", or 0 not to time them. */
+extern int intr_irqsoff;
+void intr_print_stats (void);
+
 #endif /* threads/interrupt.h */
@@ -1,46 +1,115 @@
 #include "threads/malloc.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <list.h>
 #include <round.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
+   The size of each request, in bytes, is rounded up to the
+   nearest size class and assigned to the "descriptor" that
+   manages blocks of that size.  There are four size classes per
+   power of 2, a quarter of it apart (16, 20, 24, 28, 32, 40,
+   ...), so that less than a fifth of a block goes unused.  The
+   descriptor keeps a list of free blocks.  If the free list is
+   nonempty, one of its blocks is used to satisfy the request.
 
-   Otherwise, a new page of memory, called an "arena", is
+   Otherwise, a new "arena" of one or a few contiguous pages is
    obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
+   malloc() returns a null pointer).  Each descriptor uses the
+   smallest arena that leaves little room unused at its end,
+   which for blocks bigger than a fraction of a page means more
+   than one page.  The new arena is divided into blocks, all of
+   which are added to the descriptor's free list.  Then we return
+   one of the new blocks.
 
    When we free a block, we add it to its descriptor's free list.
    But if the arena that the block was in now has no in-use
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   The page allocator records the arena that owns each of its
+   pages, which is how free() finds the arena of a block that
+   does not lie in the arena's first page.
+
+   In front of each descriptor are two "magazines" of recently
+   freed blocks, so that most malloc() and free() calls only push
+   or pop a magazine with interrupts off and take no lock.  When
+   both magazines run empty (or full), the descriptor exchanges one for a full (or empty) magazine from
+   the descriptor's "depot", under the descriptor's lock, which
+   moves a whole magazine of blocks at once.  A depot that has
+   no full magazine fills one from the free list; a depot that
+   already holds enough full magazines gives the blocks of
+   another back to the free list.  Blocks in magazines still
+   count as used in their arenas.  malloc_set_magazines() turns
+   the magazines off, so that every call takes the descriptor's
+   lock and uses its free list directly.
+
+   Blocks bigger than the largest size class are handled by
+   allocating contiguous pages with the page allocator and
+   sticking the allocation size at the beginning of the
+   allocated block's arena header. */
+
+/* Size classes run from MIN_BLOCK_SIZE up to the last one below
+   MAX_BLOCK_SIZE, CLASSES_PER_POWER of them per power of 2. */
+#define MIN_BLOCK_SIZE 16
+#define MAX_BLOCK_SIZE PGSIZE
+#define CLASSES_PER_POWER 4
+
+/* Largest arena, in pages. */
+#define ARENA_MAX_PAGES 4
+
+/* Most blocks in a magazine.  Magazines of big blocks hold
+   fewer, about a quarter page of blocks. */
+#define MAG_ROUNDS 15
+
+/* Full and empty magazines each kept in a depot. */
+#define DEPOT_MAX 2
+
+/* A magazine of free blocks. */
+struct magazine
+  {
+    struct list_elem elem;      /* Element in a depot list. */
+    size_t cnt;                 /* Number of blocks in ROUNDS. */
+    struct block *rounds[MAG_ROUNDS]; /* Free blocks. */
+  };
 
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
+    size_t arena_pages;         /* Number of pages in an arena. */
+    size_t mag_rounds;          /* Number of blocks in a full magazine. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+
+    /* Depot, protected by LOCK. */
+    struct list full_mags;      /* Full magazines. */
+    struct list empty_mags;     /* Empty magazines. */
+    size_t full_cnt;            /* Number of magazines in FULL_MAGS. */
+    size_t empty_cnt;           /* Number of magazines in EMPTY_MAGS. */
+
+    /* Magazines, accessed with interrupts off. */
+    struct magazine *loaded;    /* Magazine in use, or null. */
+    struct magazine *previous;  /* Spare magazine, or null. */
+
+    /* Statistics, updated with interrupts off. */
+    uint64_t alloc_cnt;         /* Blocks allocated. */
+    uint64_t free_cnt;          /* Blocks freed. */
+    uint64_t requested;         /* Bytes requested. */
+    uint64_t allocated;         /* Bytes of the blocks handed out. */
+
+    /* Statistics, protected by LOCK. */
+    size_t arena_cnt;           /* Arenas allocated. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -61,9 +130,35 @@ struct block
   };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[32];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Statistics of big blocks. */
+static struct lock big_lock;    /* Protects the statistics below. */
+static size_t big_page_cnt;     /* Pages in use. */
+static size_t big_used_cnt;     /* Blocks in use. */
+static uint64_t big_alloc_cnt;  /* Blocks ever allocated. */
+static uint64_t big_requested;  /* Bytes ever requested. */
+static uint64_t big_allocated;  /* Bytes of the blocks handed out. */
+
+/* Magazines of all descriptors. */
+static struct kmem_cache mag_cache;
+
+/* Whether malloc() and free() go through the magazines. */
+static bool magazines_enabled = true;
+
+static void init_desc (struct desc *, size_t block_size);
+static struct block *malloc_slow (struct desc *, size_t size);
+static void free_slow (struct desc *, struct block *);
+static struct block *mag_pop (struct desc *);
+static bool mag_push (struct desc *, struct block *);
+static void count_alloc (struct desc *, size_t size);
+static struct magazine *depot_get_empty (struct desc *);
+static void depot_put (struct desc *, struct magazine *);
+static void mag_free (struct desc *, struct magazine *);
+static struct block *desc_get_block (struct desc *);
+static void desc_put_block (struct desc *, struct block *);
+static struct desc *size_to_desc (size_t);
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
 
@@ -71,17 +166,67 @@ static struct block *arena_to_block (struct arena *, size_t idx);
 void
 malloc_init (void) 
 {
-  size_t block_size;
+  size_t power, i;
+
+  for (power = MIN_BLOCK_SIZE; power < MAX_BLOCK_SIZE; power *= 2)
+    for (i = 0; i < CLASSES_PER_POWER; i++)
+      {
+        ASSERT (desc_cnt < sizeof descs / sizeof *descs);
+        init_desc (&descs[desc_cnt++],
+                   power + i * (power / CLASSES_PER_POWER));
+      }
+
+  lock_init (&big_lock);
+  lock_set_name (&big_lock, "malloc big");
+  kmem_cache_create (&mag_cache, "magazine", sizeof (struct magazine),
+                     NULL);
+}
 
-  for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
+/* Initializes descriptor D for blocks of BLOCK_SIZE bytes.  Its
+   arenas have the fewest pages that leave at most 1/16 of them
+   unused, or if there are none, the pages that leave the
+   smallest part unused. */
+static void
+init_desc (struct desc *d, size_t block_size)
+{
+  size_t best_pages = 0, best_waste = 0;
+  size_t pages;
+
+  for (pages = 1; pages <= ARENA_MAX_PAGES; pages++)
     {
-      struct desc *d = &descs[desc_cnt++];
-      ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-      d->block_size = block_size;
-      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-      list_init (&d->free_list);
-      lock_init (&d->lock);
+      size_t size = pages * PGSIZE;
+      size_t waste = ((size - sizeof (struct arena)) % block_size
+                      + sizeof (struct arena));
+
+      if (best_pages == 0 || waste * best_pages < best_waste * pages)
+        {
+          best_pages = pages;
+          best_waste = waste;
+        }
+      if (waste * 16 <= size)
+        break;
     }
+
+  d->block_size = block_size;
+  d->arena_pages = best_pages;
+  d->blocks_per_arena = ((best_pages * PGSIZE - sizeof (struct arena))
+                         / block_size);
+  d->mag_rounds = PGSIZE / 4 / block_size;
+  if (d->mag_rounds < 1)
+    d->mag_rounds = 1;
+  else if (d->mag_rounds > MAG_ROUNDS)
+    d->mag_rounds = MAG_ROUNDS;
+  list_init (&d->free_list);
+  lock_init (&d->lock);
+  lock_set_name (&d->lock, "malloc");
+  list_init (&d->full_mags);
+  list_init (&d->empty_mags);
+  d->full_cnt = 0;
+  d->empty_cnt = 0;
+  d->loaded = d->previous = NULL;
+  d->alloc_cnt = d->free_cnt = 0;
+  d->requested = d->allocated = 0;
+  d->arena_cnt = 0;
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -92,6 +237,7 @@ malloc (size_t size)
   struct desc *d;
   struct block *b;
   struct arena *a;
+  enum intr_level old_level;
 
   /* A null pointer satisfies a request for 0 bytes. */
   if (size == 0)
@@ -99,10 +245,8 @@ malloc (size_t size)
 
   /* Find the smallest descriptor that satisfies a SIZE-byte
      request. */
-  for (d = descs; d < descs + desc_cnt; d++)
-    if (d->block_size >= size)
-      break;
-  if (d == descs + desc_cnt) 
+  d = size_to_desc (size);
+  if (d == NULL) 
     {
       /* SIZE is too big for any descriptor.
          Allocate enough pages to hold SIZE plus an arena. */
@@ -116,41 +260,30 @@ malloc (size_t size)
       a->magic = ARENA_MAGIC;
       a->desc = NULL;
       a->free_cnt = page_cnt;
+      palloc_set_owner (a, page_cnt, a);
+
+      lock_acquire (&big_lock);
+      big_page_cnt += page_cnt;
+      big_used_cnt++;
+      big_alloc_cnt++;
+      big_requested += size;
+      big_allocated += page_cnt * PGSIZE - sizeof *a;
+      lock_release (&big_lock);
       return a + 1;
     }
 
-  lock_acquire (&d->lock);
-
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
+  /* Take a block from the magazines, if they have one. */
+  b = NULL;
+  if (magazines_enabled)
     {
-      size_t i;
-
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL) 
-        {
-          lock_release (&d->lock);
-          return NULL; 
-        }
-
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
-        {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
-        }
+      old_level = intr_disable ();
+      b = mag_pop (d);
+      if (b != NULL)
+        count_alloc (d, size);
+      intr_set_level (old_level);
     }
 
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
-  lock_release (&d->lock);
-  return b;
+  return b != NULL ? b : malloc_slow (d, size);
 }
 
 /* Allocates and return A times B bytes initialized to zeroes.
@@ -227,47 +360,462 @@ free (void *p)
       if (d != NULL) 
         {
           /* It's a normal block.  We handle it here. */
+          enum intr_level old_level;
+          bool cached = false;
 
 #ifndef NDEBUG
           /* Clear the block to help detect use-after-free bugs. */
           memset (b, 0xcc, d->block_size);
 #endif
   
-          lock_acquire (&d->lock);
-
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
-
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
+          /* Put the block in the magazines, if they have room
+             for it. */
+          if (magazines_enabled)
             {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
+              old_level = intr_disable ();
+              cached = mag_push (d, b);
+              if (cached)
+                d->free_cnt++;
+              intr_set_level (old_level);
             }
 
-          lock_release (&d->lock);
+          if (!cached)
+            free_slow (d, b);
         }
       else
         {
           /* It's a big block.  Free its pages. */
-          palloc_free_multiple (a, a->free_cnt);
+          size_t page_cnt = a->free_cnt;
+
+          palloc_free_multiple (a, page_cnt);
+
+          lock_acquire (&big_lock);
+          big_page_cnt -= page_cnt;
+          big_used_cnt--;
+          lock_release (&big_lock);
           return;
         }
     }
 }
+
+/* Turns the magazines on if ENABLE is true, or off if it is
+   false.  Turning them off gives the blocks they hold back to
+   the free lists, after which every malloc() and free() of a
+   small block takes its descriptor's lock and free list, as
+   they did before there were magazines.  Meant for comparing
+   the two. */
+void
+malloc_set_magazines (bool enable)
+{
+  struct desc *d;
+
+  magazines_enabled = enable;
+  if (enable)
+    return;
+
+  for (d = descs; d < descs + desc_cnt; d++)
+    {
+      struct magazine *m, *loaded, *previous;
+      enum intr_level old_level;
+
+      lock_acquire (&d->lock);
+      old_level = intr_disable ();
+      loaded = d->loaded;
+      previous = d->previous;
+      d->loaded = d->previous = NULL;
+      intr_set_level (old_level);
+
+      if (loaded != NULL)
+        mag_free (d, loaded);
+      if (previous != NULL)
+        mag_free (d, previous);
+      while (!list_empty (&d->full_mags))
+        {
+          m = list_entry (list_pop_front (&d->full_mags),
+                          struct magazine, elem);
+          mag_free (d, m);
+        }
+      while (!list_empty (&d->empty_mags))
+        {
+          m = list_entry (list_pop_front (&d->empty_mags),
+                          struct magazine, elem);
+          mag_free (d, m);
+        }
+      d->full_cnt = d->empty_cnt = 0;
+      lock_release (&d->lock);
+    }
+}
+
+/* Prints, for each size class in use since boot, the bytes
+   requested and the bytes of the blocks handed out for them,
+   and the share of the latter lost to rounding up.  Also prints
+   the pages and blocks of each class still in use, and the free
+   blocks held in magazines. */
+void
+malloc_print_stats (void)
+{
+  uint64_t requested = big_requested, allocated = big_allocated;
+  struct desc *d;
+
+  printf ("Malloc size classes (sizes in bytes):\n");
+  printf ("  %6s %6s %7s %7s %9s %12s %12s %6s\n", "class", "pages",
+          "in use", "cached", "allocs", "requested", "allocated", "waste");
+  for (d = descs; d < descs + desc_cnt; d++)
+    {
+      size_t cached = d->full_cnt * d->mag_rounds;
+
+      if (d->alloc_cnt == 0)
+        continue;
+      if (d->loaded != NULL)
+        cached += d->loaded->cnt;
+      if (d->previous != NULL)
+        cached += d->previous->cnt;
+
+      printf ("  %6zu %6zu %7"PRIu64" %7zu %9"PRIu64" %12"PRIu64
+              " %12"PRIu64" %5"PRIu64"%%\n", d->block_size,
+              d->arena_cnt * d->arena_pages, d->alloc_cnt - d->free_cnt,
+              cached, d->alloc_cnt, d->requested, d->allocated,
+              (d->allocated - d->requested) * 100 / d->allocated);
+      requested += d->requested;
+      allocated += d->allocated;
+    }
+  if (big_alloc_cnt > 0)
+    printf ("  %6s %6zu %7zu %7s %9"PRIu64" %12"PRIu64" %12"PRIu64
+            " %5"PRIu64"%%\n", "big", big_page_cnt, big_used_cnt, "",
+            big_alloc_cnt, big_requested, big_allocated,
+            (big_allocated - big_requested) * 100 / big_allocated);
+  if (allocated > 0)
+    printf ("  %6s %6s %7s %7s %9s %12"PRIu64" %12"PRIu64" %5"PRIu64"%%\n",
+            "total", "", "", "", "", requested, allocated,
+            (allocated - requested) * 100 / allocated);
+}
 
+/* Allocates a block of descriptor D for a SIZE-byte request
+   when both of its magazines are empty.  Exchanges the
+   empty magazine for a full one from the depot, or fills one
+   from the free list, or without memory for a magazine takes a
+   single block from it.  Returns a null pointer if memory is not
+   available. */
+static struct block *
+malloc_slow (struct desc *d, size_t size)
+{
+  struct magazine *m, *spare;
+  enum intr_level old_level;
+  struct block *b;
+
+  lock_acquire (&d->lock);
+
+  m = NULL;
+  if (magazines_enabled && !list_empty (&d->full_mags))
+    {
+      m = list_entry (list_pop_front (&d->full_mags), struct magazine, elem);
+      d->full_cnt--;
+    }
+  else if (magazines_enabled)
+    {
+      m = depot_get_empty (d);
+      if (m != NULL)
+        {
+          while (m->cnt < d->mag_rounds
+                 && (b = desc_get_block (d)) != NULL)
+            m->rounds[m->cnt++] = b;
+          if (m->cnt == 0)
+            {
+              depot_put (d, m);
+              lock_release (&d->lock);
+              return NULL;
+            }
+        }
+    }
+
+  /* Without magazines, or memory for one, take a single block. */
+  if (m == NULL)
+    {
+      b = desc_get_block (d);
+      if (b != NULL)
+        {
+          old_level = intr_disable ();
+          count_alloc (d, size);
+          intr_set_level (old_level);
+        }
+      lock_release (&d->lock);
+      return b;
+    }
+
+  /* Load M, unless another thread refilled the magazines in the
+     meantime. */
+  old_level = intr_disable ();
+  b = mag_pop (d);
+  if (b != NULL)
+    spare = m;
+  else
+    {
+      spare = d->previous;
+      d->previous = d->loaded;
+      d->loaded = m;
+      b = mag_pop (d);
+    }
+  count_alloc (d, size);
+  intr_set_level (old_level);
+
+  if (spare != NULL)
+    depot_put (d, spare);
+  lock_release (&d->lock);
+  return b;
+}
+
+/* Frees block B of descriptor D when both of its magazines are
+   full.  Exchanges the full magazine for an empty
+   one, leaving it in the depot, or without memory for a
+   magazine puts B back on the free list. */
+static void
+free_slow (struct desc *d, struct block *b)
+{
+  struct magazine *m, *spare;
+  enum intr_level old_level;
+
+  lock_acquire (&d->lock);
+
+  m = magazines_enabled ? depot_get_empty (d) : NULL;
+
+  /* Load M, unless another thread made room in the magazines in
+     the meantime. */
+  old_level = intr_disable ();
+  d->free_cnt++;
+  spare = m;
+  if (mag_push (d, b))
+    b = NULL;
+  else if (m != NULL)
+    {
+      spare = d->previous;
+      d->previous = d->loaded;
+      d->loaded = m;
+      m->rounds[m->cnt++] = b;
+      b = NULL;
+    }
+  intr_set_level (old_level);
+
+  if (b != NULL)
+    desc_put_block (d, b);
+  if (spare != NULL)
+    depot_put (d, spare);
+  lock_release (&d->lock);
+}
+
+/* Takes a block from the magazines of descriptor D and returns
+   it, or returns a null pointer if both are empty.  Interrupts
+   must be off. */
+static struct block *
+mag_pop (struct desc *d)
+{
+  struct magazine *m;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  m = d->loaded;
+  if (m == NULL || m->cnt == 0)
+    {
+      m = d->previous;
+      if (m == NULL || m->cnt == 0)
+        return NULL;
+      d->previous = d->loaded;
+      d->loaded = m;
+    }
+  return m->rounds[--m->cnt];
+}
+
+/* Puts block B in the magazines of descriptor D.  Returns false
+   if both are full.  Interrupts must be off. */
+static bool
+mag_push (struct desc *d, struct block *b)
+{
+  struct magazine *m;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  m = d->loaded;
+  if (m == NULL || m->cnt >= d->mag_rounds)
+    {
+      m = d->previous;
+      if (m == NULL || m->cnt >= d->mag_rounds)
+        return false;
+      d->previous = d->loaded;
+      d->loaded = m;
+    }
+  m->rounds[m->cnt++] = b;
+  return true;
+}
+
+/* Counts a block of descriptor D handed out for a SIZE-byte
+   request.  Interrupts must be off. */
+static void
+count_alloc (struct desc *d, size_t size)
+{
+  d->alloc_cnt++;
+  d->requested += size;
+  d->allocated += d->block_size;
+}
+
+/* Returns an empty magazine from the depot of descriptor D, or a
+   new one, or a null pointer if memory is not available.  D's
+   lock must be held. */
+static struct magazine *
+depot_get_empty (struct desc *d)
+{
+  struct magazine *m;
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  if (!list_empty (&d->empty_mags))
+    {
+      m = list_entry (list_pop_front (&d->empty_mags),
+                      struct magazine, elem);
+      d->empty_cnt--;
+    }
+  else
+    {
+      m = kmem_cache_alloc (&mag_cache);
+      if (m != NULL)
+        m->cnt = 0;
+    }
+  return m;
+}
+
+/* Returns magazine M to the depot of descriptor D, whose lock
+   must be held.  The depot keeps up to DEPOT_MAX full magazines,
+   for later allocations, and as many empty ones, for later
+   frees.  Any other magazine gives its blocks back to the free
+   list. */
+static void
+depot_put (struct desc *d, struct magazine *m)
+{
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  if (m->cnt == d->mag_rounds && d->full_cnt < DEPOT_MAX)
+    {
+      list_push_front (&d->full_mags, &m->elem);
+      d->full_cnt++;
+      return;
+    }
+
+  while (m->cnt > 0)
+    desc_put_block (d, m->rounds[--m->cnt]);
+  if (d->empty_cnt < DEPOT_MAX)
+    {
+      list_push_front (&d->empty_mags, &m->elem);
+      d->empty_cnt++;
+    }
+  else
+    kmem_cache_free (&mag_cache, m);
+}
+
+/* Gives the blocks in magazine M back to the free list of
+   descriptor D, whose lock must be held, and frees M. */
+static void
+mag_free (struct desc *d, struct magazine *m)
+{
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  while (m->cnt > 0)
+    desc_put_block (d, m->rounds[--m->cnt]);
+  kmem_cache_free (&mag_cache, m);
+}
+
+/* Takes a block from the free list of descriptor D, creating a
+   new arena if the list is empty, and returns it.  Returns a
+   null pointer if memory is not available.  D's lock must be
+   held. */
+static struct block *
+desc_get_block (struct desc *d)
+{
+  struct block *b;
+  struct arena *a;
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  /* If the free list is empty, create a new arena. */
+  if (list_empty (&d->free_list))
+    {
+      size_t i;
+
+      /* Allocate the arena's pages. */
+      a = palloc_get_multiple (0, d->arena_pages);
+      if (a == NULL)
+        return NULL;
+
+      /* Initialize arena and add its blocks to the free list. */
+      a->magic = ARENA_MAGIC;
+      a->desc = d;
+      a->free_cnt = d->blocks_per_arena;
+      palloc_set_owner (a, d->arena_pages, a);
+      for (i = 0; i < d->blocks_per_arena; i++)
+        {
+          struct block *b = arena_to_block (a, i);
+          list_push_back (&d->free_list, &b->free_elem);
+        }
+      d->arena_cnt++;
+    }
+
+  /* Get a block from free list and return it. */
+  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+  a = block_to_arena (b);
+  a->free_cnt--;
+  return b;
+}
+
+/* Puts block B back on the free list of descriptor D, and frees
+   its arena if that leaves it entirely unused.  D's lock must be
+   held. */
+static void
+desc_put_block (struct desc *d, struct block *b)
+{
+  struct arena *a = block_to_arena (b);
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  /* Add block to free list. */
+  list_push_front (&d->free_list, &b->free_elem);
+
+  /* If the arena is now entirely unused, free it. */
+  if (++a->free_cnt >= d->blocks_per_arena)
+    {
+      size_t i;
+
+      ASSERT (a->free_cnt == d->blocks_per_arena);
+      for (i = 0; i < d->blocks_per_arena; i++)
+        {
+          struct block *b = arena_to_block (a, i);
+          list_remove (&b->free_elem);
+        }
+      palloc_free_multiple (a, d->arena_pages);
+      d->arena_cnt--;
+    }
+}
+
+/* Returns the descriptor of the smallest size class that holds
+   SIZE bytes, or a null pointer if SIZE is too big for any.
+   Since the classes are a quarter of a power of 2 apart, the
+   class follows from the most significant bit of SIZE - 1 and
+   the two bits after it. */
+static struct desc *
+size_to_desc (size_t size)
+{
+  size_t m, msb, idx;
+
+  if (size <= MIN_BLOCK_SIZE)
+    return &descs[0];
+
+  m = size - 1;
+  msb = 31 - __builtin_clz (m);
+  idx = (msb - 4) * CLASSES_PER_POWER + ((m >> (msb - 2)) & 3) + 1;
+  return idx < desc_cnt ? &descs[idx] : NULL;
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
 {
-  struct arena *a = pg_round_down (b);
+  struct arena *a = palloc_get_owner (b);
 
   /* Check that the arena is valid. */
   ASSERT (a != NULL);
@@ -275,8 +823,9 @@ block_to_arena (struct block *b)
 
   /* Check that the block is properly aligned for the arena. */
   ASSERT (a->desc == NULL
-          || (pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
-  ASSERT (a->desc != NULL || pg_ofs (b) == sizeof *a);
+          || ((uint8_t *) b - (uint8_t *) (a + 1))
+             % a->desc->block_size == 0);
+  ASSERT (a->desc != NULL || (void *) b == (void *) (a + 1));
 
   return a;
 }
@@ -2,6 +2,7 @@
 #define THREADS_MALLOC_H
 
 #include <debug.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 void malloc_init (void);
@@ -10,4 +11,7 @@ void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
 
+void malloc_set_magazines (bool enable);
+void malloc_print_stats (void);
+
 #endif /* threads/malloc.h */
@@ -2,6 +2,7 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -9,6 +10,7 @@
 #include <string.h>
 #include "threads/loader.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,22 +25,95 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Its free pages form
+   blocks of 2**ORDER pages, aligned to their size, kept on one
+   free list per order.  A request takes a block of the smallest
+   order that fits, splitting bigger blocks in halves as needed,
+   and gives the pages beyond the request back.  A freed block
+   merges with its "buddy", the other half of the block of the
+   next order, for as long as that buddy is free as a whole.
+   Both take time proportional to the number of orders rather
+   than to the size of the pool.  Single pages, by far the most
+   common request, are also freed onto a short stack, from which
+   they are reused without splitting or merging.
+
+   A low-priority thread also keeps a few free pages of each pool
+   zeroed in advance, on a list of their own, from which requests
+   for a single page with PAL_ZERO are served without clearing
+   it.  The thread runs when nothing else needs the CPU, so that
+   neither creating a process nor a page fault has to wait for a
+   page to be cleared.
+
+   Each page may also be given an owner, such as the header of
+   the malloc() arena it belongs to, which palloc_get_owner()
+   then finds from any address within the page. */
+
+/* Number of block orders: the biggest block has
+   2**(BUDDY_ORDERS - 1) pages. */
+#define BUDDY_ORDERS 20
+
+/* Most single pages kept on a pool's stack. */
+#define PAGE_STACK_MAX 32
+
+/* Zeroed pages kept in each pool.  Taking one that leaves fewer
+   than ZEROED_LOW wakes up the thread that zeroes them, which
+   only does so while the pool has more than ZEROED_RESERVE free
+   pages besides. */
+#define ZEROED_MAX 16
+#define ZEROED_LOW 8
+#define ZEROED_RESERVE 64
 
 /* A memory pool. */
 struct pool
   {
     struct lock lock;                   /* Mutual exclusion. */
+    const char *name;                   /* Name, for statistics. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
+    void **owners;                      /* Owner of each page. */
+    uint8_t *free_orders;               /* 1 + order of each free block,
+                                           at its first page, else 0. */
+    struct list free_lists[BUDDY_ORDERS]; /* Free blocks of each order. */
+    size_t free_cnts[BUDDY_ORDERS];     /* Number of blocks of each order. */
+    size_t free_pages;                  /* Pages in the free lists. */
+    struct list page_stack;             /* Recently freed single pages. */
+    size_t stack_cnt;                   /* Number of pages on PAGE_STACK. */
+    struct list zeroed;                 /* Free pages zeroed in advance. */
+    size_t zeroed_cnt;                  /* Number of pages on ZEROED. */
+
+    /* Statistics. */
+    size_t fail_cnt;                    /* Requests that found no block. */
+    size_t zeroed_hits;                 /* PAL_ZERO pages found zeroed. */
+    size_t zeroed_misses;               /* PAL_ZERO pages cleared on demand. */
     uint8_t *base;                      /* Base of pool. */
   };
 
+/* A free block, or a page on a page stack. */
+struct free_block
+  {
+    struct list_elem elem;              /* Free list or stack element. */
+  };
+
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Wakes up the thread that zeroes pages. */
+static struct semaphore zero_sema;
+
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
-static bool page_from_pool (const struct pool *, void *page);
+static size_t buddy_get (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void buddy_insert (struct pool *, size_t page_idx, unsigned order);
+static void buddy_remove (struct pool *, size_t page_idx, unsigned order);
+static size_t pop_page (struct pool *, struct list *);
+static void flush_page_lists (struct pool *);
+static void zero_pages (void *aux) NO_RETURN;
+static void refill_zeroed (struct pool *);
+static void print_pool_stats (struct pool *);
+static bool page_from_pool (const struct pool *, const void *page);
+static struct pool *page_to_pool (const void *page);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -59,6 +134,15 @@ palloc_init (size_t user_page_limit)
   init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
   init_pool (&user_pool, free_start + kernel_pages * PGSIZE,
              user_pages, "user pool");
+  sema_init (&zero_sema, 0);
+}
+
+/* Starts the thread that keeps pages zeroed in advance.  Called
+   once threads can be created. */
+void
+palloc_start_zeroing (void)
+{
+  thread_create ("pagezero", PRI_MIN, zero_pages, NULL);
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
@@ -73,14 +157,51 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
   void *pages;
   size_t page_idx;
+  bool zeroed = false, wake = false;
 
   if (page_cnt == 0)
     return NULL;
 
   lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+  if (page_cnt == 1 && (flags & PAL_ZERO) && pool->zeroed_cnt > 0)
+    {
+      page_idx = pop_page (pool, &pool->zeroed);
+      pool->zeroed_cnt--;
+      pool->zeroed_hits++;
+      zeroed = true;
+      wake = pool->zeroed_cnt < ZEROED_LOW;
+    }
+  else if (page_cnt == 1 && pool->stack_cnt > 0)
+    {
+      page_idx = pop_page (pool, &pool->page_stack);
+      pool->stack_cnt--;
+    }
+  else
+    {
+      page_idx = buddy_get (pool, page_cnt);
+      if (page_idx == BITMAP_ERROR
+          && pool->stack_cnt + pool->zeroed_cnt > 0)
+        {
+          /* The stacked and zeroed pages may merge into a big
+             enough block. */
+          flush_page_lists (pool);
+          page_idx = buddy_get (pool, page_cnt);
+        }
+    }
+  if (page_idx != BITMAP_ERROR)
+    {
+      ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+      bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+      if ((flags & PAL_ZERO) && page_cnt == 1 && !zeroed)
+        pool->zeroed_misses++;
+    }
+  else
+    pool->fail_cnt++;
   lock_release (&pool->lock);
 
+  if (wake)
+    sema_up (&zero_sema);
+
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
   else
@@ -88,7 +209,10 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 
   if (pages != NULL) 
     {
-      if (flags & PAL_ZERO)
+      /* A zeroed page only needs its list element cleared. */
+      if (zeroed)
+        memset (pages, 0, sizeof (struct free_block));
+      else if (flags & PAL_ZERO)
         memset (pages, 0, PGSIZE * page_cnt);
     }
   else 
@@ -124,21 +248,26 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   if (pages == NULL || page_cnt == 0)
     return;
 
-  if (page_from_pool (&kernel_pool, pages))
-    pool = &kernel_pool;
-  else if (page_from_pool (&user_pool, pages))
-    pool = &user_pool;
-  else
-    NOT_REACHED ();
-
+  pool = page_to_pool (pages);
   page_idx = pg_no (pages) - pg_no (pool->base);
 
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
+  memset (pool->owners + page_idx, 0, page_cnt * sizeof *pool->owners);
 #endif
 
+  lock_acquire (&pool->lock);
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  if (page_cnt == 1 && pool->stack_cnt < PAGE_STACK_MAX)
+    {
+      struct free_block *b = pages;
+      list_push_front (&pool->page_stack, &b->elem);
+      pool->stack_cnt++;
+    }
+  else
+    buddy_free (pool, page_idx, page_cnt);
+  lock_release (&pool->lock);
 }
 
 /* Frees the page at PAGE. */
@@ -148,31 +277,302 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Records OWNER as the owner of the PAGE_CNT allocated pages
+   starting at PAGES. */
+void
+palloc_set_owner (void *pages, size_t page_cnt, void *owner)
+{
+  struct pool *pool = page_to_pool (pages);
+  size_t page_idx = pg_no (pages) - pg_no (pool->base);
+  size_t i;
+
+  ASSERT (pg_ofs (pages) == 0);
+  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+
+  for (i = 0; i < page_cnt; i++)
+    pool->owners[page_idx + i] = owner;
+}
+
+/* Returns the owner recorded for the page that contains ADDR,
+   or a null pointer if it has none. */
+void *
+palloc_get_owner (const void *addr)
+{
+  struct pool *pool = page_to_pool (addr);
+
+  return pool->owners[pg_no (addr) - pg_no (pool->base)];
+}
+
+/* Prints, for each pool, its free pages, the biggest block they
+   form and the share of them outside that block, and the number
+   of free blocks of each size. */
+void
+palloc_print_stats (void)
+{
+  printf ("Page pools (sizes in pages):\n");
+  print_pool_stats (&kernel_pool);
+  print_pool_stats (&user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
+  /* We'll put the pool's used_map, followed by its owners and
+     its free orders, at its base.  Calculate the space needed
+     for them and subtract it from the pool's size. */
+  size_t bm_size = ROUND_UP (bitmap_buf_size (page_cnt), sizeof (void *));
+  size_t meta_pages = DIV_ROUND_UP (bm_size + page_cnt * sizeof (void *)
+                                    + page_cnt, PGSIZE);
+  unsigned order;
+
+  if (meta_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  page_cnt -= meta_pages;
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
   lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  lock_set_name (&p->lock, name);
+  p->name = name;
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->owners = (void **) ((uint8_t *) base + bm_size);
+  memset (p->owners, 0, page_cnt * sizeof *p->owners);
+  p->free_orders = (uint8_t *) (p->owners + page_cnt);
+  memset (p->free_orders, 0, page_cnt);
+  for (order = 0; order < BUDDY_ORDERS; order++)
+    {
+      list_init (&p->free_lists[order]);
+      p->free_cnts[order] = 0;
+    }
+  p->free_pages = 0;
+  list_init (&p->page_stack);
+  p->stack_cnt = 0;
+  list_init (&p->zeroed);
+  p->zeroed_cnt = 0;
+  p->fail_cnt = 0;
+  p->zeroed_hits = 0;
+  p->zeroed_misses = 0;
+  p->base = base + meta_pages * PGSIZE;
+
+  /* Free all of the pool's pages. */
+  buddy_free (p, 0, page_cnt);
+}
+
+/* Allocates a block of PAGE_CNT pages from POOL, whose lock
+   must be held, and returns the index of its first page, or
+   BITMAP_ERROR if there is no free block big enough. */
+static size_t
+buddy_get (struct pool *pool, size_t page_cnt)
+{
+  unsigned want, order;
+  size_t page_idx;
+
+  ASSERT (lock_held_by_current_thread (&pool->lock));
+
+  /* Find the smallest free block that holds PAGE_CNT pages. */
+  for (want = 0; want < BUDDY_ORDERS && ((size_t) 1 << want) < page_cnt;
+       want++)
+    continue;
+  for (order = want; order < BUDDY_ORDERS; order++)
+    if (!list_empty (&pool->free_lists[order]))
+      break;
+  if (order >= BUDDY_ORDERS)
+    return BITMAP_ERROR;
+
+  page_idx = (pg_no (list_front (&pool->free_lists[order]))
+              - pg_no (pool->base));
+  buddy_remove (pool, page_idx, order);
+
+  /* Split it down to the order wanted, freeing the upper halves,
+     then give back the pages beyond PAGE_CNT. */
+  while (order > want)
+    {
+      order--;
+      buddy_insert (pool, page_idx + ((size_t) 1 << order), order);
+    }
+  if (((size_t) 1 << want) > page_cnt)
+    buddy_free (pool, page_idx + page_cnt,
+                ((size_t) 1 << want) - page_cnt);
+  return page_idx;
+}
+
+/* Frees the PAGE_CNT pages of POOL starting at page PAGE_IDX,
+   as the biggest aligned blocks they divide into, merging each
+   with its buddy while that is free.  POOL's lock must be held,
+   or POOL not yet in use. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  size_t pool_cnt = bitmap_size (pool->used_map);
+
+  while (page_cnt > 0)
+    {
+      unsigned order = 0;
+      size_t idx = page_idx;
+
+      /* Take the biggest aligned block that starts the range. */
+      while (order + 1 < BUDDY_ORDERS
+             && idx % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+
+      /* Merge it with its buddy for as long as that is free. */
+      while (order + 1 < BUDDY_ORDERS)
+        {
+          size_t buddy = idx ^ ((size_t) 1 << order);
+
+          if (buddy + ((size_t) 1 << order) > pool_cnt
+              || pool->free_orders[buddy] != order + 1)
+            break;
+          buddy_remove (pool, buddy, order);
+          idx &= ~((size_t) 1 << order);
+          order++;
+        }
+      buddy_insert (pool, idx, order);
+    }
+}
+
+/* Adds the free block of POOL of the given ORDER, starting at
+   page PAGE_IDX, to its free list. */
+static void
+buddy_insert (struct pool *pool, size_t page_idx, unsigned order)
+{
+  struct free_block *b = (struct free_block *) (pool->base
+                                                + page_idx * PGSIZE);
+
+  ASSERT (page_idx % ((size_t) 1 << order) == 0);
+  pool->free_orders[page_idx] = order + 1;
+  list_push_front (&pool->free_lists[order], &b->elem);
+  pool->free_cnts[order]++;
+  pool->free_pages += (size_t) 1 << order;
+}
+
+/* Removes the free block of POOL of the given ORDER, starting at
+   page PAGE_IDX, from its free list. */
+static void
+buddy_remove (struct pool *pool, size_t page_idx, unsigned order)
+{
+  struct free_block *b = (struct free_block *) (pool->base
+                                                + page_idx * PGSIZE);
+
+  ASSERT (pool->free_orders[page_idx] == order + 1);
+  pool->free_orders[page_idx] = 0;
+  list_remove (&b->elem);
+  pool->free_cnts[order]--;
+  pool->free_pages -= (size_t) 1 << order;
+}
+
+/* Takes the first page off LIST, POOL's page stack or zeroed
+   pages, and returns its index. */
+static size_t
+pop_page (struct pool *pool, struct list *list)
+{
+  struct list_elem *e = list_pop_front (list);
+  return pg_no (e) - pg_no (pool->base);
+}
+
+/* Moves the pages on POOL's page stack and its zeroed pages into
+   its free lists, where they may merge into bigger blocks.
+   POOL's lock must be held. */
+static void
+flush_page_lists (struct pool *pool)
+{
+  while (!list_empty (&pool->page_stack))
+    buddy_free (pool, pop_page (pool, &pool->page_stack), 1);
+  while (!list_empty (&pool->zeroed))
+    buddy_free (pool, pop_page (pool, &pool->zeroed), 1);
+  pool->stack_cnt = 0;
+  pool->zeroed_cnt = 0;
+}
+
+/* Thread function that zeroes pages in advance, whenever a pool
+   runs low on them. */
+static void
+zero_pages (void *aux UNUSED)
+{
+  /* Under the advanced schedulers, priority follows niceness. */
+  if (thread_mlfqs || thread_cfs)
+    thread_set_nice (20);
+
+  for (;;)
+    {
+      refill_zeroed (&kernel_pool);
+      refill_zeroed (&user_pool);
+      sema_down (&zero_sema);
+    }
+}
+
+/* Zeroes free pages of POOL and adds them to its zeroed pages,
+   until it has ZEROED_MAX of them or its free pages run low.
+   Pages are cleared without holding POOL's lock. */
+static void
+refill_zeroed (struct pool *pool)
+{
+  for (;;)
+    {
+      struct free_block *b;
+      size_t page_idx;
+
+      lock_acquire (&pool->lock);
+      if (pool->zeroed_cnt >= ZEROED_MAX
+          || pool->free_pages <= ZEROED_RESERVE)
+        {
+          lock_release (&pool->lock);
+          return;
+        }
+      page_idx = buddy_get (pool, 1);
+      bitmap_mark (pool->used_map, page_idx);
+      lock_release (&pool->lock);
+
+      b = (struct free_block *) (pool->base + page_idx * PGSIZE);
+      memset (b, 0, PGSIZE);
+
+      lock_acquire (&pool->lock);
+      bitmap_reset (pool->used_map, page_idx);
+      list_push_front (&pool->zeroed, &b->elem);
+      pool->zeroed_cnt++;
+      lock_release (&pool->lock);
+    }
+}
+
+/* Prints the statistics of POOL for palloc_print_stats(). */
+static void
+print_pool_stats (struct pool *pool)
+{
+  size_t free_cnt = pool->free_pages + pool->stack_cnt + pool->zeroed_cnt;
+  size_t largest = 0;
+  unsigned order;
+
+  for (order = 0; order < BUDDY_ORDERS; order++)
+    if (pool->free_cnts[order] > 0)
+      largest = (size_t) 1 << order;
+  if (largest == 0 && free_cnt > 0)
+    largest = 1;
+
+  printf ("  %s: %zu pages, %zu free, %zu stacked, largest block %zu, "
+          "%zu%% fragmented, %zu failures\n", pool->name,
+          bitmap_size (pool->used_map), free_cnt, pool->stack_cnt, largest,
+          free_cnt > 0 ? 100 - largest * 100 / free_cnt : 0,
+          pool->fail_cnt);
+  printf ("    %zu zeroed, PAL_ZERO pages found zeroed %zu of %zu times\n",
+          pool->zeroed_cnt, pool->zeroed_hits,
+          pool->zeroed_hits + pool->zeroed_misses);
+  printf ("    free blocks:");
+  for (order = 0; order < BUDDY_ORDERS; order++)
+    if (pool->free_cnts[order] > 0)
+      printf (" %zux%zu", pool->free_cnts[order], (size_t) 1 << order);
+  printf ("\n");
 }
 
 /* Returns true if PAGE was allocated from POOL,
    false otherwise. */
 static bool
-page_from_pool (const struct pool *pool, void *page) 
+page_from_pool (const struct pool *pool, const void *page) 
 {
   size_t page_no = pg_no (page);
   size_t start_page = pg_no (pool->base);
@@ -180,3 +580,15 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the pool that PAGE was allocated from. */
+static struct pool *
+page_to_pool (const void *page)
+{
+  if (page_from_pool (&kernel_pool, page))
+    return &kernel_pool;
+  else if (page_from_pool (&user_pool, page))
+    return &user_pool;
+  else
+    NOT_REACHED ();
+}
@@ -0,0 +1,163 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Samples are counted in a hash table keyed by address and tid,
+   allocated at boot so that the timer interrupt never has to
+   allocate.  A sample whose slot is not found within
+   PROFILE_PROBE_MAX probes is dropped rather than evicting
+   another. */
+#define PROFILE_PAGES 8
+#define PROFILE_PROBE_MAX 16
+
+/* Number of addresses printed for the kernel and for user
+   programs each. */
+#define PROFILE_PRINT_MAX 20
+
+/* Sample count of an address in one thread. */
+struct profile_slot
+  {
+    uintptr_t eip;              /* Interrupted address. */
+    tid_t tid;                  /* Running thread. */
+    unsigned count;             /* Samples, 0 if the slot is free. */
+  };
+
+unsigned profile_interval;
+
+static struct profile_slot *slots;
+static size_t slot_cnt;         /* Power of 2. */
+static unsigned countdown;      /* Timer interrupts until next sample. */
+static unsigned sample_cnt;     /* Samples taken. */
+static unsigned dropped_cnt;    /* Samples that found no slot. */
+
+static int compare_slots (const void *, const void *);
+static void print_addresses (const struct profile_slot *,
+                             const char *domain, bool user);
+
+/* Allocates the sample table, if profiling was asked for. */
+void
+profile_init (void)
+{
+  size_t max_cnt = PROFILE_PAGES * PGSIZE / sizeof *slots;
+
+  if (profile_interval == 0)
+    return;
+
+  slots = palloc_get_multiple (PAL_ZERO, PROFILE_PAGES);
+  if (slots == NULL)
+    PANIC ("profile: no memory for samples");
+  for (slot_cnt = 1; slot_cnt * 2 <= max_cnt; slot_cnt *= 2)
+    continue;
+  countdown = profile_interval;
+}
+
+/* Called by the timer interrupt handler with the frame F of the
+   interrupted code.  Records a sample every profile_interval
+   calls. */
+void
+profile_sample (const struct intr_frame *f)
+{
+  uintptr_t eip;
+  tid_t tid;
+  size_t i, probe;
+
+  if (slots == NULL || --countdown > 0)
+    return;
+  countdown = profile_interval;
+  sample_cnt++;
+
+  eip = (uintptr_t) f->eip;
+  tid = thread_current ()->tid;
+  i = (eip * 2654435761u) ^ (unsigned) tid;
+  for (probe = 0; probe < PROFILE_PROBE_MAX; probe++, i++)
+    {
+      struct profile_slot *s = &slots[i & (slot_cnt - 1)];
+      if (s->count == 0)
+        {
+          s->eip = eip;
+          s->tid = tid;
+        }
+      else if (s->eip != eip || s->tid != tid)
+        continue;
+      s->count++;
+      return;
+    }
+  dropped_cnt++;
+}
+
+/* Prints the hottest addresses, for the kernel and for user
+   programs, most samples first.  Each table is followed by its
+   addresses on one line, in the same order, which can be passed
+   as is to utils/backtrace, along with the user program for the
+   user addresses. */
+void
+profile_print_stats (void)
+{
+  struct profile_slot *table = slots;
+
+  if (table == NULL)
+    return;
+
+  /* Sorting scrambles the hash table, so stop sampling first. */
+  slots = NULL;
+  barrier ();
+  qsort (table, slot_cnt, sizeof *table, compare_slots);
+  printf ("Profile: %u samples, one every %u timer interrupts, "
+          "%u dropped.\n", sample_cnt, profile_interval, dropped_cnt);
+  print_addresses (table, "kernel", false);
+  print_addresses (table, "user", true);
+}
+
+/* Orders profile slots by decreasing sample count. */
+static int
+compare_slots (const void *a_, const void *b_)
+{
+  const struct profile_slot *a = a_;
+  const struct profile_slot *b = b_;
+
+  return a->count < b->count ? 1 : a->count > b->count ? -1 : 0;
+}
+
+/* Prints the hottest addresses in TABLE, sorted by
+   compare_slots(), that belong to user programs if USER is true,
+   or to the kernel if not. */
+static void
+print_addresses (const struct profile_slot *table, const char *domain,
+                 bool user)
+{
+  size_t i, printed;
+
+  printf ("Profile %s: %8s %5s  %s\n", domain, "samples", "tid", "address");
+  for (i = printed = 0; i < slot_cnt && printed < PROFILE_PRINT_MAX; i++)
+    {
+      const struct profile_slot *s = &table[i];
+      if (s->count == 0)
+        break;
+      if (is_user_vaddr ((void *) s->eip) == user)
+        {
+          printf ("Profile %s: %8u %5d  %#"PRIxPTR"\n",
+                  domain, s->count, s->tid, s->eip);
+          printed++;
+        }
+    }
+
+  printf ("Profile %s addresses:", domain);
+  for (i = printed = 0; i < slot_cnt && printed < PROFILE_PRINT_MAX; i++)
+    {
+      const struct profile_slot *s = &table[i];
+      if (s->count == 0)
+        break;
+      if (is_user_vaddr ((void *) s->eip) == user)
+        {
+          printf (" %#"PRIxPTR, s->eip);
+          printed++;
+        }
+    }
+  printf ("\n");
+}
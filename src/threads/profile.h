@@ -0,0 +1,21 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include "threads/interrupt.h"
+
+/* Statistical profiler.
+
+   With -profile=N, every Nth timer interrupt records the address
+   it interrupted, in the kernel or in a user program, and the tid
+   of the running thread.  The hottest addresses are printed at
+   shutdown, along with lists that utils/backtrace turns into
+   function names and source lines. */
+
+/* Timer interrupts between samples, or 0 if not profiling. */
+extern unsigned profile_interval;
+
+void profile_init (void);
+void profile_sample (const struct intr_frame *);
+void profile_print_stats (void);
+
+#endif /* threads/profile.h */
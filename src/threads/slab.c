@@ -0,0 +1,274 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Alignment of objects, enough for any type the kernel uses. */
+#define KMEM_ALIGN 8
+
+/* Number of empty slabs a cache keeps for later allocations.
+   Slabs beyond that go back to the page allocator. */
+#define KMEM_EMPTY_MAX 1
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* A slab: one page, starting with this header and a bitmap of
+   its free objects, followed by the objects. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in one of the cache's lists. */
+    size_t free_cnt;            /* Number of free objects. */
+    uint32_t free_map[];        /* Bit set for each free object. */
+  };
+
+/* All caches, for statistics.  Changed with interrupts off. */
+static struct list caches = LIST_INITIALIZER (caches);
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+static void *slab_to_obj (struct slab *, size_t idx);
+
+/* Initializes C as a cache of objects of SIZE bytes, named NAME,
+   each initialized by CTOR, if it is nonnull, when its slab is
+   created. */
+void
+kmem_cache_create (struct kmem_cache *c, const char *name, size_t size,
+                   kmem_ctor *ctor)
+{
+  enum intr_level old_level;
+  size_t cnt;
+
+  ASSERT (c != NULL);
+  ASSERT (name != NULL);
+  ASSERT (size > 0);
+
+  c->name = name;
+  c->size = size;
+  c->obj_size = ROUND_UP (size, KMEM_ALIGN);
+  c->ctor = ctor;
+
+  /* Fit as many objects as possible after the header and the
+     bitmap, which itself grows with the number of objects. */
+  for (cnt = (PGSIZE - sizeof (struct slab)) / c->obj_size; cnt > 0; cnt--)
+    {
+      c->obj_ofs = ROUND_UP (sizeof (struct slab)
+                             + DIV_ROUND_UP (cnt, 32) * sizeof (uint32_t),
+                             KMEM_ALIGN);
+      if (c->obj_ofs + cnt * c->obj_size <= PGSIZE)
+        break;
+    }
+  ASSERT (cnt > 0);
+  c->obj_cnt = cnt;
+
+  lock_init (&c->lock);
+  lock_set_name (&c->lock, name);
+  list_init (&c->partial);
+  list_init (&c->full);
+  list_init (&c->empty);
+  c->empty_cnt = 0;
+  c->slab_cnt = 0;
+  c->used_cnt = 0;
+  c->alloc_cnt = 0;
+
+  old_level = intr_disable ();
+  list_push_back (&caches, &c->elem);
+  intr_set_level (old_level);
+}
+
+/* Obtains an object from cache C and returns it.  Returns a null
+   pointer if memory is not available.  The object is in the
+   state the constructor left it in, or in the state it was
+   freed in; without a constructor its contents are undefined. */
+void *
+kmem_cache_alloc (struct kmem_cache *c)
+{
+  struct slab *s;
+  size_t word, bit;
+
+  ASSERT (c != NULL);
+
+  lock_acquire (&c->lock);
+
+  /* Fill partial slabs first, then reuse an empty one. */
+  if (!list_empty (&c->partial))
+    s = list_entry (list_front (&c->partial), struct slab, elem);
+  else if (!list_empty (&c->empty))
+    {
+      s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+      c->empty_cnt--;
+      list_push_front (&c->partial, &s->elem);
+    }
+  else
+    {
+      s = slab_create (c);
+      if (s == NULL)
+        {
+          lock_release (&c->lock);
+          return NULL;
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  /* Take the first free object. */
+  for (word = 0; s->free_map[word] == 0; word++)
+    ASSERT (word * 32 < c->obj_cnt);
+  bit = __builtin_ctz (s->free_map[word]);
+  s->free_map[word] &= ~((uint32_t) 1 << bit);
+  if (--s->free_cnt == 0)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->full, &s->elem);
+    }
+
+  c->used_cnt++;
+  c->alloc_cnt++;
+  lock_release (&c->lock);
+  return slab_to_obj (s, word * 32 + bit);
+}
+
+/* Returns object OBJ, which must have been obtained from cache C
+   with kmem_cache_alloc(), to C.  A null OBJ is ignored. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj)
+{
+  struct slab *s;
+  size_t idx;
+  uint32_t mask;
+
+  ASSERT (c != NULL);
+
+  if (obj == NULL)
+    return;
+
+  s = obj_to_slab (c, obj);
+  idx = ((uint8_t *) obj - ((uint8_t *) s + c->obj_ofs)) / c->obj_size;
+  mask = (uint32_t) 1 << (idx % 32);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     it has to stay constructed. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+
+  ASSERT ((s->free_map[idx / 32] & mask) == 0);
+  s->free_map[idx / 32] |= mask;
+  if (s->free_cnt++ == 0)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->partial, &s->elem);
+    }
+  if (s->free_cnt == c->obj_cnt)
+    {
+      list_remove (&s->elem);
+      if (c->empty_cnt < KMEM_EMPTY_MAX)
+        {
+          list_push_front (&c->empty, &s->elem);
+          c->empty_cnt++;
+        }
+      else
+        {
+          s->magic = 0;
+          palloc_free_page (s);
+          c->slab_cnt--;
+        }
+    }
+  c->used_cnt--;
+
+  lock_release (&c->lock);
+}
+
+/* Prints statistics for each cache: how much of the memory of
+   its slabs its objects use, and how much is wasted on slab
+   headers, unused room at the end of slabs, alignment and free
+   objects. */
+void
+kmem_print_stats (void)
+{
+  struct list_elem *e;
+
+  if (list_empty (&caches))
+    return;
+
+  printf ("Slab caches (sizes in bytes):\n");
+  printf ("  %-16s %6s %6s %7s %10s %6s %8s %6s\n", "name", "size",
+          "/slab", "in use", "allocated", "slabs", "wasted", "waste");
+  for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+      size_t total = c->slab_cnt * PGSIZE;
+      size_t wasted = total - c->used_cnt * c->size;
+
+      printf ("  %-16s %6zu %6zu %7zu %10"PRIu64" %6zu %8zu %5zu%%\n",
+              c->name, c->size, c->obj_cnt, c->used_cnt, c->alloc_cnt,
+              c->slab_cnt, wasted, total != 0 ? wasted * 100 / total : 0);
+    }
+}
+
+/* Allocates a new slab for cache C, with all of its objects
+   free and constructed.  Returns a null pointer if memory is not
+   available.  C's lock must be held. */
+static struct slab *
+slab_create (struct kmem_cache *c)
+{
+  struct slab *s;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&c->lock));
+
+  s = palloc_get_page (0);
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->free_cnt = c->obj_cnt;
+  for (i = 0; i < DIV_ROUND_UP (c->obj_cnt, 32); i++)
+    s->free_map[i] = UINT32_MAX;
+  if (c->obj_cnt % 32 != 0)
+    s->free_map[i - 1] = ((uint32_t) 1 << (c->obj_cnt % 32)) - 1;
+
+  if (c->ctor != NULL)
+    for (i = 0; i < c->obj_cnt; i++)
+      c->ctor (slab_to_obj (s, i));
+
+  c->slab_cnt++;
+  return s;
+}
+
+/* Returns the slab of cache C that object OBJ is inside. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj)
+{
+  struct slab *s = pg_round_down (obj);
+
+  /* Check that the slab is valid and belongs to C. */
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT (pg_ofs (obj) >= c->obj_ofs);
+  ASSERT ((pg_ofs (obj) - c->obj_ofs) % c->obj_size == 0);
+
+  return s;
+}
+
+/* Returns the IDX'th object within slab S. */
+static void *
+slab_to_obj (struct slab *s, size_t idx)
+{
+  ASSERT (s != NULL);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (idx < s->cache->obj_cnt);
+  return (uint8_t *) s + s->cache->obj_ofs + idx * s->cache->obj_size;
+}
@@ -0,0 +1,58 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* Object caches.
+
+   A cache hands out objects of a single size, carved out of
+   page-sized slabs, so that frequently allocated kernel objects
+   neither round up to malloc()'s next power of 2 nor search its
+   descriptors.  Each slab starts with a header and a bitmap of
+   its free objects.  The cache keeps its slabs on three lists,
+   partial, full and empty, and allocates from a partial slab
+   first, so that objects pack into as few slabs as possible.
+
+   An optional constructor puts each object in its initial state
+   once, when its slab is created.  Objects must be freed in that
+   same state, which spares initializing them, locks for example,
+   on every allocation. */
+
+/* Initializes object OBJ of a cache. */
+typedef void kmem_ctor (void *obj);
+
+/* An object cache. */
+struct kmem_cache
+  {
+    const char *name;           /* Name, for statistics. */
+    size_t size;                /* Size requested for each object. */
+    size_t obj_size;            /* Size of each object, aligned. */
+    size_t obj_cnt;             /* Number of objects in a slab. */
+    size_t obj_ofs;             /* Offset of the first object in a slab. */
+    kmem_ctor *ctor;            /* Constructor, or a null pointer. */
+
+    struct lock lock;           /* Protects the lists and statistics. */
+    struct list partial;        /* Slabs with free and used objects. */
+    struct list full;           /* Slabs with no free object. */
+    struct list empty;          /* Slabs with no used object. */
+    size_t empty_cnt;           /* Number of slabs on EMPTY. */
+
+    /* Statistics. */
+    size_t slab_cnt;            /* Slabs allocated. */
+    size_t used_cnt;            /* Objects in use. */
+    uint64_t alloc_cnt;         /* Objects ever allocated. */
+
+    struct list_elem elem;      /* Element in the list of all caches. */
+  };
+
+void kmem_cache_create (struct kmem_cache *, const char *name, size_t size,
+                        kmem_ctor *);
+void *kmem_cache_alloc (struct kmem_cache *) __attribute__ ((malloc));
+void kmem_cache_free (struct kmem_cache *, void *);
+
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
@@ -27,15 +27,49 @@
 */
 
 #include "threads/synch.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+
+/* If true, locks gather contention statistics.
+   Controlled by kernel command-line option "-lockstat". */
+bool synch_lockstat;
+
+/* Statistics of the names given with lock_set_name(), printed at
+   shutdown.  They live here rather than in the locks themselves,
+   so that a named lock may be freed or initialized again. */
+#define LOCK_NAME_MAX 32
+static struct lock_stats lock_names[LOCK_NAME_MAX];
+static size_t lock_name_cnt;
 
 static void sema_test_helper (void *sema_);
 //a thread gives its priority to the lock
 //which could modify the holder's priority
 static void fu_donate_priority(struct lock *l, int i_waiter_priority);
+//makes the current thread the holder of a free lock
+static void fu_lock_take(struct lock *l);
+//accounts for an acquisition of a lock which was waited on since
+//I64_WAIT_START, or was free if I64_WAIT_START is negative
+static void fu_lock_stat_acquired(struct lock *l, int64_t i64_wait_start);
+//queues the current thread on a wait queue at its effective priority
+static void fu_wait_enqueue(struct plist *pl, struct list_elem *le);
+//takes the thread queued first at the highest priority off a wait queue of
+//threads
+static struct thread *fu_wait_dequeue(struct plist *pl);
+
+/* A thread waiting on a condition variable. */
+struct cond_waiter
+  {
+    struct list_elem elem;      /* Element of the condition's waiters. */
+    struct thread *thread;      /* The waiting thread. */
+  };
+
+//how many holders down a nested chain of locks a donation is passed on
+#define DONATION_DEPTH_MAX 8
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -52,7 +86,7 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  plist_init (&sema->waiters);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -75,7 +109,7 @@ sema_down (struct semaphore *sema)
   {
       struct thread *t = thread_current();
       ASSERT(&t->elem != NULL);
-      list_insert_ordered (&sema->waiters, &t->elem, fu_comp_priority, NULL);
+      fu_wait_enqueue (&sema->waiters, &t->elem);
       thread_block ();
   }
   sema->value--;
@@ -120,14 +154,9 @@ sema_up (struct semaphore *sema)
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
-  //remembers the first waiting thread
-  if (!list_empty (&sema->waiters))
-  {
-    struct thread *t_first_waiting = NULL;
-    t_first_waiting = list_entry(list_pop_front(&sema->waiters),
-                                 struct thread, elem);
-    thread_unblock(t_first_waiting);
-  }
+  //wakes up the first of the waiting threads with the highest priority
+  if (!plist_empty (&sema->waiters))
+    thread_unblock(fu_wait_dequeue(&sema->waiters));
   sema->value++;
 
   fu_necessary_to_yield();
@@ -190,8 +219,10 @@ lock_init (struct lock *lock)
   ASSERT (lock != NULL);
 
   lock->holder = NULL;
-  lock->i_lock_priority = 0;
-  list_init (&lock->waiters);
+  lock->i_lock_priority = PRI_MIN - 1;
+  plist_init (&lock->waiters);
+  lock->stats = NULL;
+  lock->acquired_ns = 0;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -215,23 +246,40 @@ lock_acquire (struct lock *lock)
 
   //the current thread can not wait on any other lock
   struct thread *t = thread_current();
+  int64_t i64_wait_start = -1;
+  uint64_t ui64_wait_cycles = 0;
+  //an uncontended acquisition reads no clock; a contended one is timed for
+  //the thread's resource usage, so the trace reuses that time
+  if (lock->holder != NULL)
+  {
+    if (synch_lockstat)
+      i64_wait_start = timer_ns ();
+    ui64_wait_cycles = timer_cycles();
+  }
   while (lock->holder != NULL) 
   {
       ASSERT(&t->elem != NULL);
+      t->l_waiting_on = lock;
+      fu_wait_enqueue (&lock->waiters, &t->elem);
       if(thread_mlfqs == false)
       {
         //priority donation if we are NOT using the advanced scheduler
         fu_donate_priority(lock, thread_get_priority());
-        list_insert_ordered (&lock->waiters, &t->elem, fu_comp_priority, NULL);
       }
       thread_block ();
   }
-  lock->holder = thread_current();
-  if(thread_mlfqs == false)
+  t->l_waiting_on = NULL;
+  fu_lock_take(lock);
+  if (synch_lockstat)
+    fu_lock_stat_acquired(lock, i64_wait_start);
+  if (ui64_wait_cycles != 0)
   {
-    list_insert_ordered(&lock->holder->l_locks_held, &lock->le,
-                        fu_lcomp_locks, NULL);
+    ui64_wait_cycles = timer_cycles() - ui64_wait_cycles;
+    t->ui32_lock_blocks++;
+    t->ui64_lock_wait_cycles += ui64_wait_cycles;
   }
+  if (trace_enabled)
+    trace_event(TRACE_LOCK_ACQUIRE, (uintptr_t) lock, ui64_wait_cycles, 0);
 
   intr_set_level (old_level);
 }
@@ -254,7 +302,9 @@ lock_try_acquire (struct lock *lock)
   old_level = intr_disable ();
   if (lock->holder == NULL) 
   {
-    lock->holder = thread_current ();
+    fu_lock_take(lock);
+    if (synch_lockstat)
+      fu_lock_stat_acquired(lock, -1);
     success = true; 
   }
   else
@@ -279,36 +329,16 @@ lock_release (struct lock *lock)
   enum intr_level old_level;
 
   old_level = intr_disable ();
-  if (!list_empty (&lock->waiters))
-  {
-    struct thread *t_first_waiting;
-    //remembers the first waiting thread
-    t_first_waiting = list_entry(list_pop_front(&lock->waiters),
-                                 struct thread, elem);
-    list_remove(&t_first_waiting->elem);
-    thread_unblock(t_first_waiting);
-  }
-
-  if(thread_mlfqs == false)
-  {
-    //reset the priority of the list
-    if (!list_empty (&lock->waiters))
-    {
-      //the priority of the list becomes the priority of the second waiter
-      lock->i_lock_priority =  list_entry(list_front(&lock->waiters),
-                                       struct thread, elem)->priority;
-    }
-    else
-    {
-      lock->i_lock_priority = 0;
-    }
-    list_remove(&lock->le);
-  }
-  else
+  if (synch_lockstat && lock->stats != NULL)
+    lock->stats->hold_ns += timer_ns () - lock->acquired_ns;
+  //the donation made through the lock goes away with it
+  if(lock->i_lock_priority >= PRI_MIN)
   {
-    //if we are using the advanced scheduler, this list should be empty
-    ASSERT(list_empty(&lock->waiters));
+    fu_thread_donation_remove(lock->holder, lock->i_lock_priority);
+    lock->i_lock_priority = PRI_MIN - 1;
   }
+  if (!plist_empty (&lock->waiters))
+    thread_unblock(fu_wait_dequeue(&lock->waiters));
   lock->holder = NULL;
 
   fu_necessary_to_yield();
@@ -325,7 +355,155 @@ lock_held_by_current_thread (const struct lock *lock)
 
   return lock->holder == thread_current ();
 }
+
+/* Names LOCK in the lock statistics printed at shutdown under
+   -lockstat.  NAME must stay valid for as long as the kernel
+   runs.  Locks which share a name share their statistics, which
+   outlive them, so LOCK may be freed at any time.  Once there are
+   LOCK_NAME_MAX names, locks with a new one are left unnamed. */
+void
+lock_set_name (struct lock *lock, const char *name)
+{
+  enum intr_level old_level;
+  size_t i;
+
+  ASSERT (lock != NULL);
+  ASSERT (name != NULL);
+
+  old_level = intr_disable ();
+  for (i = 0; i < lock_name_cnt; i++)
+    if (!strcmp (lock_names[i].name, name))
+      break;
+  if (i == lock_name_cnt && lock_name_cnt < LOCK_NAME_MAX)
+    lock_names[lock_name_cnt++].name = name;
+  lock->stats = i < lock_name_cnt ? &lock_names[i] : NULL;
+  intr_set_level (old_level);
+}
+
+/* Prints the statistics of the named locks, if -lockstat was
+   given. */
+void
+lock_print_stats (void)
+{
+  size_t i;
+
+  if (!synch_lockstat)
+    return;
+
+  printf ("Lock statistics (times in us):\n");
+  printf ("  %-16s %9s %9s %10s %9s %10s\n",
+          "name", "acquired", "contended", "wait", "max wait", "held");
+  for (i = 0; i < lock_name_cnt; i++)
+    {
+      struct lock_stats *s = &lock_names[i];
+      printf ("  %-16s %9"PRIu32" %9"PRIu32" %10"PRId64" %9"PRId64
+              " %10"PRId64"\n", s->name, s->acquired_cnt, s->contended_cnt,
+              s->wait_ns / 1000, s->max_wait_ns / 1000, s->hold_ns / 1000);
+    }
+}
 
+/* Initializes RW as a reader-writer lock held by no one.
+
+   Readers and writers wait in a single queue, in priority order,
+   on the lock inside RW.  A writer holds that lock for as long as
+   it writes, and a reader only while it comes in.  This gives
+   writers preference: once a writer is waiting for the current
+   readers to leave, new readers queue up behind it, and they
+   donate their priority to it like the waiters of any lock.
+
+   Readers are not recorded, so nothing is donated to them: a
+   writer waiting for the current readers to leave, and the
+   threads queued up behind it, may wait for as long as a
+   low-priority reader is kept off the CPU.  Keep read sections
+   short. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  rw->reader_cnt = 0;
+  rw->drainer = NULL;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   waits for it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_read_acquire (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  rw->reader_cnt++;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for reading.  The
+   last reader to leave wakes up a writer waiting for it. */
+void
+rwlock_read_release (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  ASSERT (rw->reader_cnt > 0);
+  if (--rw->reader_cnt == 0 && rw->drainer != NULL)
+  {
+    thread_unblock (rw->drainer);
+    rw->drainer = NULL;
+    fu_necessary_to_yield ();
+  }
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  The current thread must not already hold RW.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_write_acquire (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  //the readers which came in before can not be stopped, only waited for
+  old_level = intr_disable ();
+  while (rw->reader_cnt > 0)
+  {
+    rw->drainer = thread_current ();
+    thread_block ();
+  }
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread holds for writing. */
+void
+rwlock_write_release (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (rw->reader_cnt == 0);
+
+  lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise. */
+bool
+rwlock_write_held_by_current_thread (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return lock_held_by_current_thread (&rw->lock) && rw->reader_cnt == 0;
+}
 
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
@@ -335,7 +513,7 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  plist_init (&cond->waiters);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -361,18 +539,24 @@ cond_init (struct condition *cond)
 void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
-  struct semaphore_elem waiter;
+  struct cond_waiter waiter;
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
   
-  sema_init (&waiter.semaphore, 0);
-  ASSERT(&waiter.elem != NULL);
-  list_push_front(&cond->waiters, &waiter.elem);
+  old_level = intr_disable ();
+  waiter.thread = thread_current ();
+  fu_wait_enqueue (&cond->waiters, &waiter.elem);
   lock_release (lock);
-  sema_down (&waiter.semaphore);
+  //cond_signal() takes the waiter off the queue before waking it up
+  //releasing the lock may have yielded, so the thread might not have
+  //blocked before it is signaled
+  while (waiter.thread->pl_waiting_on != NULL)
+    thread_block ();
+  intr_set_level (old_level);
   lock_acquire (lock);
 }
 
@@ -391,12 +575,19 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters))
+  enum intr_level old_level = intr_disable ();
+  if (!plist_empty (&cond->waiters))
   {
-    struct list_elem *le_min = list_min (&cond->waiters, fu_comp_priority, cond);
-    list_remove(le_min);
-    sema_up (&list_entry (le_min, struct semaphore_elem, elem)->semaphore);
+    struct cond_waiter *waiter = list_entry (plist_front (&cond->waiters),
+                                             struct cond_waiter, elem);
+    struct thread *t = waiter->thread;
+    plist_pop_max (&cond->waiters);
+    t->pl_waiting_on = NULL;
+    if (t->status == THREAD_BLOCKED)
+      thread_unblock (t);
+    fu_necessary_to_yield ();
   }
+  intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -411,78 +602,126 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!plist_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
 
-//comparison function for list which holds locks and orderes them by their 
-//priority
-bool
-fu_lcomp_locks(const struct list_elem *a,
-              const struct list_elem *b,
-              void *aux UNUSED)
+//makes the current thread the holder of a free lock
+//the threads still waiting on the lock donate their priority to the new holder
+static void
+fu_lock_take(struct lock *l)
 {
-  ASSERT(thread_mlfqs == false);
-  ASSERT(a != NULL);
-  ASSERT(b != NULL);
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(l->holder == NULL);
+  ASSERT(l->i_lock_priority < PRI_MIN);
 
-  //obtains the threads which are encompassing those elements
-  struct lock *l_a = list_entry(a, struct lock, le);
-  struct lock *l_b = list_entry(b, struct lock, le);
+  l->holder = thread_current();
+  if(thread_mlfqs == false && !plist_empty(&l->waiters))
+  {
+    l->i_lock_priority = plist_max_priority(&l->waiters);
+    fu_thread_donation_add(l->holder, l->i_lock_priority);
+  }
+}
 
-  ASSERT(l_a != NULL);
-  ASSERT(l_b != NULL);
+//accounts for an acquisition of a lock which was waited on since
+//I64_WAIT_START, or was free if I64_WAIT_START is negative
+static void
+fu_lock_stat_acquired(struct lock *l, int64_t i64_wait_start)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+  struct lock_stats *s = l->stats;
+  int64_t i64_now = timer_ns();
+
+  l->acquired_ns = i64_now;
+  if(s == NULL)
+    return;
+  s->acquired_cnt++;
+  if(i64_wait_start >= 0)
+  {
+    int64_t i64_wait = i64_now - i64_wait_start;
+    s->contended_cnt++;
+    s->wait_ns += i64_wait;
+    if(i64_wait > s->max_wait_ns)
+      s->max_wait_ns = i64_wait;
+  }
+}
 
-  //establishes decreasing ordering
-  return l_a->i_lock_priority > l_b->i_lock_priority;
+//queues the current thread on a wait queue at its effective priority
+//LE is the element it is queued with
+static void
+fu_wait_enqueue(struct plist *pl, struct list_elem *le)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+  struct thread *t = thread_current();
+
+  t->pl_waiting_on = pl;
+  t->le_waiting = le;
+  t->i_wait_priority = thread_get_priority();
+  plist_push(pl, le, t->i_wait_priority);
+}
+
+//takes the thread queued first at the highest priority off a wait queue of
+//threads
+static struct thread *
+fu_wait_dequeue(struct plist *pl)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+  struct thread *t = list_entry(plist_pop_max(pl), struct thread, elem);
+
+  t->pl_waiting_on = NULL;
+  return t;
 }
 
 //a thread gives its priority to the lock
 //which could modify the holder's priority
+//if the holder is itself waiting on a lock, the donation is passed on to that
+//lock's holder and so on, at most DONATION_DEPTH_MAX holders deep
 static void fu_donate_priority(struct lock *l, int i_waiter_priority)
 {
   ASSERT(thread_mlfqs == false);
   ASSERT(intr_get_level() == INTR_OFF);
   ASSERT(l != NULL);
   ASSERT(m_valid_priority(i_waiter_priority));
-  ASSERT(m_valid_priority(l->i_lock_priority));
-  //when donnation takes place, there certainly is a lock holder
-  ASSERT(l->holder != NULL);
 
-  if(i_waiter_priority > l->i_lock_priority)
+  int i_depth;
+  for(i_depth = 0; i_depth < DONATION_DEPTH_MAX; i_depth++)
   {
+    //when donnation takes place, there certainly is a lock holder
+    ASSERT(l->holder != NULL);
+    if(i_waiter_priority <= l->i_lock_priority)
+      return;
+
     struct thread *t = l->holder;
-    //holder's priority unaffected by current thread's priority
     int i_holder_priority = fu_thread_get_priority(t);
+    //moves the lock's donation up in the holder's donation heap
+    if(l->i_lock_priority >= PRI_MIN)
+      fu_thread_donation_remove(t, l->i_lock_priority);
     l->i_lock_priority = i_waiter_priority;
-    ASSERT(m_valid_priority(i_holder_priority));
+    fu_thread_donation_add(t, i_waiter_priority);
 
-    //if the lock is already in the list it gets removed
-    if(list_entry(&l->le, struct lock, le) != NULL)
+    //comparing the thread with it
+    if(i_waiter_priority <= i_holder_priority)
+      return;
+    //can not be the running thread
+    ASSERT(t->status == THREAD_READY ||
+           t->status == THREAD_BLOCKED);
+    //a holder queued on a semaphore, lock or condition moves up its queue
+    if(t->pl_waiting_on != NULL)
     {
-      list_remove(&l->le);
+      plist_remove(t->pl_waiting_on, t->le_waiting, t->i_wait_priority);
+      t->i_wait_priority = i_waiter_priority;
+      plist_push(t->pl_waiting_on, t->le_waiting, t->i_wait_priority);
     }
-    list_insert_ordered(&t->l_locks_held, &l->le, fu_lcomp_locks, NULL);
-
-    //comparing the thread with it
-    if(l->i_lock_priority > i_holder_priority)
+    if(t->status == THREAD_READY)
     {
-      //can not be the running thread
-      ASSERT(t->status == THREAD_READY ||
-             t->status == THREAD_BLOCKED);
-      //the lock holder gets reinserted in the ready list_init
-      if(t->status == THREAD_BLOCKED)
-      {
-        list_remove(&t->elem);
-        thread_unblock(t);
-      }
-      else
-      {
-        //reinsert the given thread into the ready list taking into account its
-        //priority
-        fu_thread_reinsert_ready_list(t);
-      }
+      //reinsert the given thread into the ready list taking into account its
+      //priority
+      fu_thread_reinsert_ready_list(t);
+      return;
     }
+    //a holder blocked on a lock donates its new priority to that lock
+    if(t->l_waiting_on == NULL)
+      return;
+    l = t->l_waiting_on;
   }
-  return;
 }
@@ -2,21 +2,16 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <plist.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <debug.h>
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
-  };
-
-/* One semaphore in a list. */
-struct semaphore_elem 
-  {
-    struct list_elem elem;              /* List element. */
-    struct semaphore semaphore;         /* This semaphore. */
+    struct plist waiters;       /* Waiting threads, by priority. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -25,18 +20,36 @@ bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
 
+/* Contention statistics of the locks sharing a name, gathered
+   under -lockstat.  Times are in nanoseconds, as measured by
+   timer_ns(). */
+struct lock_stats
+  {
+    const char *name;           /* Name in the statistics dump. */
+    uint32_t acquired_cnt;      /* Number of acquisitions. */
+    uint32_t contended_cnt;     /* Acquisitions which had to wait. */
+    int64_t wait_ns;            /* Total time spent waiting. */
+    int64_t max_wait_ns;        /* Longest wait. */
+    int64_t hold_ns;            /* Total time the lock was held. */
+  };
+
+/* If true, locks gather contention statistics.
+   Controlled by kernel command-line option "-lockstat". */
+extern bool synch_lockstat;
+
 /* Lock. */
 struct lock 
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
-    //the maximum priority which a list can provide to its current holder
-    //the maximum between the waiter's priorities
-    //set to the holder's own priority when the lock is acquired
-    struct list_elem le;
+    //the priority which the lock donates to its current holder: the maximum
+    //between the waiters' priorities, or PRI_MIN - 1 while the holder has
+    //not received a donation through this lock
     int i_lock_priority;
     //removed the semaphore component of a lock because in a scheduler which
     //implements priority donation they have entirely different purposes
-    struct list waiters;        /* List of waiting threads. */
+    struct plist waiters;       /* Waiting threads, by priority. */
+    struct lock_stats *stats;   /* Statistics of its name, or null. */
+    int64_t acquired_ns;        /* When the holder acquired the lock. */
   };
 
 void lock_init (struct lock *);
@@ -44,11 +57,30 @@ void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+void lock_set_name (struct lock *, const char *name);
+void lock_print_stats (void);
+
+/* Reader-writer lock.  Any number of readers, or a single
+   writer, may hold it at a time.  Priority is donated to the
+   writer only, never to readers. */
+struct rwlock
+  {
+    struct lock lock;           /* Held by the writer, briefly by readers. */
+    unsigned reader_cnt;        /* Number of threads reading. */
+    struct thread *drainer;     /* Writer waiting for the readers to leave. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_read_acquire (struct rwlock *);
+void rwlock_read_release (struct rwlock *);
+void rwlock_write_acquire (struct rwlock *);
+void rwlock_write_release (struct rwlock *);
+bool rwlock_write_held_by_current_thread (const struct rwlock *);
 
 /* Condition variable. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting semaphore_elems. */
+    struct plist waiters;       /* Waiting threads, by priority. */
   };
 
 void cond_init (struct condition *);
@@ -56,13 +88,6 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
-//comparison function for list which holds locks and orderes them by their 
-//priority
-bool
-fu_lcomp_locks(const struct list_elem *a,
-               const struct list_elem *b,
-               void *aux UNUSED);
-
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -1,5 +1,6 @@
 #include "threads/thread.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <random.h>
 #include <stdio.h>
@@ -10,9 +11,12 @@
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 //fixed point opearation imitating floating point operations
 #include "threads/fixed-point.h"
+#include <rbtree.h>
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -22,9 +26,27 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running.  There is one FIFO queue
+   per priority level; bit P of ready_bitmap is set if and only if
+   ready_queues[P] is non-empty, so the highest-priority ready
+   thread is found with a single bit scan. */
+static struct list ready_queues[PRI_CNT];
+static uint64_t ready_bitmap;
+//number of threads in all the ready queues
+static size_t ready_cnt;
+
+//ready threads of the completely fair scheduler, which take the place of
+//the priority queues above, ordered by virtual runtime
+static struct rb_tree cfs_tree;
+//sum of the weights of the threads in cfs_tree
+static int64_t cfs_weight;
+//never decreasing lower bound of the virtual runtimes
+static int64_t min_vruntime;
+
+//ready threads of the real-time class, ordered by absolute deadline; they
+//run before the threads of any other queue
+static struct rb_tree edf_tree;
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -39,6 +61,19 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* Pages of exited threads, most recently used first, which
+   thread_create() reuses without zeroing a fresh page or scanning
+   the page pool's bitmap.  Pages beyond THREAD_PAGE_CACHE_MAX are
+   handed back to the page allocator by a work item on the system
+   workqueue, so that the scheduler never calls into it.  The
+   cache is protected by turning interrupts off. */
+#define THREAD_PAGE_CACHE_MAX 16
+static struct list thread_page_cache;
+static size_t thread_page_cache_cnt;
+
+/* Work item which frees the pages the cache does not keep. */
+static struct work thread_page_trim_work;
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
   {
@@ -68,14 +103,79 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 //load average of the advanced scheduler
 static int64_t load_avg;
 
+//recent_cpu is decayed once per second.  Only runnable threads are decayed
+//from the timer interrupt; a blocked thread catches up on the decays it
+//missed when it is unblocked, replaying the coefficients remembered below.
+#define DECAY_HISTORY 64
+//decay coefficient of every second, indexed by epoch % DECAY_HISTORY
+static int64_t decay_history[DECAY_HISTORY];
+//number of decays applied since the OS booted
+static uint32_t decay_epoch;
+//second of uptime for which the once per second bookkeeping was last done
+//(in tickless mode the tick count may skip the exact second boundary)
+static int64_t mlfqs_second;
+
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler, which gives each
+   thread a share of the CPU proportional to a weight derived from
+   its nice value.  Controlled by kernel command-line option
+   "-cfs". */
+bool thread_cfs;
+
+//the completely fair scheduler runs the ready thread with the smallest
+//virtual runtime, which advances by the time a thread runs scaled by
+//CFS_NICE_0_WEIGHT / its weight
+#define CFS_NICE_0_WEIGHT 1024
+//nanoseconds of virtual runtime a nice 0 thread gains per tick
+#define CFS_TICK_NS (1000000000LL / TIMER_FREQ)
+//ticks in which every ready thread should get to run once, as long as there
+//are no more ready threads than it has ticks
+#define CFS_LATENCY 8
+//shortest time slice, in ticks
+#define CFS_MIN_SLICE 1
+//a thread waking up may preempt one which is ahead of it by this much
+#define CFS_WAKEUP_GRANULARITY CFS_TICK_NS
+//a thread which slept is placed this far behind min_vruntime, so that it
+//runs soon but cannot claim the CPU time it did not use while asleep
+#define CFS_SLEEPER_CREDIT (CFS_LATENCY * CFS_TICK_NS / 2)
+
+//real-time threads may reserve at most this share of the CPU, in millionths,
+//so that the other threads are not starved
+#define EDF_MAX_UTILIZATION 900000
+//share of the CPU reserved by the real-time threads, in millionths
+static int64_t edf_utilization;
+//number of real-time threads; thread_tick() skips the real-time class while
+//there are none
+static unsigned edf_thread_cnt;
+//real-time threads blocked until their next period, either because they ran
+//out of budget or because they finished their job; thread_tick() releases
+//them, so they never sit in the timer's sleep wheel, and the tickless idle
+//asks thread_edf_next_release() not to sleep past them
+static struct list edf_throttled_list;
+
+//weight of each nice value from -20 to 20; every step of nice is worth
+//about 10% of CPU time against a thread of the neighbouring value
+static const int32_t cfs_weights[41] =
+  {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */  9548,  7620,  6100,  4904,  3906,
+    /*  -5 */  3121,  2501,  1991,  1586,  1277,
+    /*   0 */  1024,   820,   655,   526,   423,
+    /*   5 */   335,   272,   215,   172,   137,
+    /*  10 */   110,    87,    70,    56,    45,
+    /*  15 */    36,    29,    23,    18,    15,
+    /*  20 */    12,
+  };
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
+static void thread_page_trim (void *aux UNUSED);
 static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
@@ -85,12 +185,70 @@ static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
 
+//appends a thread to the queue of its effective priority
+static void fu_ready_queue_push(struct thread *t);
+//removes and returns the highest-priority ready thread, or NULL
+static struct thread *fu_ready_queue_pop(void);
+//removes a thread from the queue it was appended to
+static void fu_ready_queue_remove(struct thread *t);
+//returns the highest priority with a ready thread, or -1 if there is none
+static int fu_ready_queue_max_priority(void);
+//returns the most significant bit set in a bitmap of priorities, or -1
+static int fu_priority_bitmap_max(uint64_t ui64_bitmap);
+
+//returns the weight of T for the completely fair scheduler
+static int32_t fu_cfs_weight(struct thread *t);
+//orders threads in cfs_tree by virtual runtime
+static bool fu_cfs_less(const struct rb_elem *a, const struct rb_elem *b,
+                        void *aux UNUSED);
+//returns the ready thread with the smallest virtual runtime, or NULL
+static struct thread *fu_cfs_first(void);
+//charges a tick of running time to T and advances min_vruntime
+static void fu_cfs_charge_tick(struct thread *t);
+//returns the time slice of T, in ticks, for the threads ready now
+static unsigned fu_cfs_slice(struct thread *t);
+//returns true if the first ready thread should preempt T
+static bool fu_cfs_should_preempt(struct thread *t);
+
+//orders threads in edf_tree by absolute deadline
+static bool fu_edf_less(const struct rb_elem *a, const struct rb_elem *b,
+                        void *aux UNUSED);
+//returns the ready real-time thread with the earliest deadline, or NULL
+static struct thread *fu_edf_first(void);
+//returns true if the first ready real-time thread should preempt T
+static bool fu_edf_should_preempt(struct thread *t);
+//starts the next period of real-time thread T with a full budget
+static void fu_edf_replenish(struct thread *t);
+//blocks the current real-time thread until its next period
+static void fu_edf_throttle(void);
+//unblocks the throttled real-time threads whose next period has started
+static void fu_edf_release(void);
+//returns the share of the CPU a real-time thread with these parameters takes
+static int64_t fu_edf_utilization(int64_t i64_period, int64_t i64_budget,
+                                  int64_t i64_deadline);
+
+//charges the time since the last switch to the thread leaving the CPU and to
+//the one taking it
+static void fu_thread_account_switch(struct thread *cur, struct thread *next);
+//converts TSC cycles to microseconds, or 0 if the TSC is not calibrated yet
+static int64_t fu_cycles_to_us(uint64_t ui64_cycles);
+//prints the scheduler accounting of a thread
+static void fu_thread_print_rusage(struct thread *t, void *aux UNUSED);
+
+//returns a page for a new thread, recycled if possible
+static struct thread *fu_thread_page_get(void);
+//puts the page of dead thread T in the cache of thread pages
+static void fu_thread_page_put(struct thread *t);
+
 //computes load_avg every second
 static void
 fu_thread_compute_load_avg (void);
-//calculates recent_cpu every second
+//decays recent_cpu and recomputes the priority of runnable threads
 static void
-fu_thread_compute_recent_cpu (struct thread *t, void *aux UNUSED);
+fu_thread_mlfqs_second (void);
+//applies the decays a thread missed since its recent_cpu was last updated
+static bool
+fu_thread_catch_up_recent_cpu (struct thread *t);
 //calculates prioririty for the advanced scheduler
 static void
 fu_thread_compute_priority_advanced (struct thread *t, void *aux UNUSED);
@@ -110,11 +268,27 @@ fu_thread_compute_priority_advanced (struct thread *t, void *aux UNUSED);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
+  if (thread_mlfqs && thread_cfs)
+    PANIC ("-mlfqs and -cfs cannot be used together");
+
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  lock_set_name (&tid_lock, "tid");
+  for (i = 0; i < PRI_CNT; i++)
+    list_init (&ready_queues[i]);
+  ready_bitmap = 0;
+  ready_cnt = 0;
+  rb_init (&cfs_tree, fu_cfs_less, NULL);
+  rb_init (&edf_tree, fu_edf_less, NULL);
+  cfs_weight = 0;
+  min_vruntime = 0;
   list_init (&all_list);
+  list_init (&thread_page_cache);
+  list_init (&edf_throttled_list);
+  thread_page_cache_cnt = 0;
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -126,9 +300,6 @@ thread_init (void)
     initial_thread->nice = 0;
     load_avg = 0;
   }
-  //else
-  //good to initialize it in mlfqs tests as well, just to check that it's empty
-  list_init(&initial_thread->l_locks_held);
   initial_thread->tid = allocate_tid ();
 }
 
@@ -147,6 +318,11 @@ thread_start (void)
 
   /* Wait for the idle thread to initialize idle_thread. */
   sema_down (&idle_started);
+
+  /* Create the worker which, among others, frees the pages of
+     exited threads. */
+  work_init (&thread_page_trim_work, thread_page_trim, NULL, PRI_DEFAULT);
+  workqueue_init ();
 }
 
 /* Called by the timer interrupt handler at each timer tick.
@@ -170,43 +346,78 @@ thread_tick (void)
   }
 
   //every second
-  if(thread_mlfqs && timer_ticks()%TIMER_FREQ == 0)
+  if(thread_mlfqs && timer_ticks() / TIMER_FREQ != mlfqs_second)
   {
-    //compute load average
-    fu_thread_compute_load_avg();
-    //optimization barrier - compiler must not change the order of these
-    //function calls
-    barrier();
-    //compute recent cpu
-    thread_foreach(fu_thread_compute_recent_cpu, NULL);
+    mlfqs_second = timer_ticks() / TIMER_FREQ;
+    //compute load average and decay recent cpu of runnable threads
+    fu_thread_mlfqs_second();
   }
 
 
 
+  //a real-time thread runs until it blocks or runs out of budget, unless a
+  //thread with an earlier deadline is released
+  if(edf_thread_cnt > 0)
+  {
+    fu_edf_release();
+    if(t->b_edf)
+    {
+      if(--t->i64_edf_budget_left <= 0)
+        t->b_edf_throttled = true;
+    }
+    bool b_edf_preempt = fu_edf_should_preempt(t);
+    if(b_edf_preempt || t->b_edf_throttled)
+    {
+      intr_yield_on_return();
+      return;
+    }
+    if(t->b_edf)
+      return;
+  }
+
+  if(thread_cfs)
+  {
+    if(t == idle_thread)
+      return;
+    fu_cfs_charge_tick(t);
+    //the slice shrinks as more threads become ready
+    if(++thread_ticks >= fu_cfs_slice(t) && ready_cnt > 0)
+      intr_yield_on_return();
+    return;
+  }
+
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
   {
-    if(thread_mlfqs)
+    if(thread_mlfqs && t != idle_thread)
     {
-      //compute priority based on recent_cpu
-      thread_foreach(fu_thread_compute_priority_advanced, NULL);
-      //recompute priority must come before sorting
-      barrier();
-      list_sort(&ready_list, fu_comp_priority, NULL);
+      //between two decays only the running thread's recent_cpu changes,
+      //so it is the only one whose priority needs recomputing
+      fu_thread_compute_priority_advanced(t, NULL);
     }
 
-    //sort the ready list before considering yielding
+    //recompute priority before considering yielding
     barrier();
     fu_necessary_to_yield();
   }
 }
 
-/* Prints thread statistics. */
+/* Prints thread statistics, and the scheduler accounting of the
+   threads still alive. */
 void
 thread_print_stats (void) 
 {
+  enum intr_level old_level;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+
+  printf ("Thread accounting (times in us):\n");
+  printf ("  %5s %-16s %10s %10s %7s %7s %7s %10s\n", "tid", "name", "run",
+          "wait", "vol", "invol", "locks", "lock wait");
+  old_level = intr_disable ();
+  thread_foreach (fu_thread_print_rusage, NULL);
+  intr_set_level (old_level);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -238,21 +449,20 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = fu_thread_page_get ();
   if (t == NULL)
     return TID_ERROR;
 
   /* Initialize thread. */
   ASSERT(!intr_context());
   init_thread (t, name, priority);
-  if(thread_mlfqs)
+  if(thread_mlfqs || thread_cfs)
   {
     ASSERT(!intr_context());
     t->nice = thread_current()->nice;
   }
   tid = t->tid = allocate_tid ();
-  //initializes list for the initial thread
-  list_init(&t->l_locks_held);
+  trace_thread_name (tid, name);
 
   /* Prepare thread for first run by initializing its stack.
      Do this atomically so intermediate values for the 'stack' 
@@ -296,6 +506,7 @@ thread_block (void)
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
 
+  trace_event (TRACE_BLOCK, 0, 0, 0);
   thread_current ()->status = THREAD_BLOCKED;
   schedule ();
 }
@@ -318,7 +529,18 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_insert_ordered (&ready_list, &t->elem, fu_comp_priority, NULL);
+  trace_event (TRACE_UNBLOCK, t->tid, 0, 0);
+  //from now on the thread waits for a CPU
+  t->ui64_acct_since = timer_cycles();
+  //a thread which was blocked has to catch up with the decays it missed
+  if(thread_mlfqs && fu_thread_catch_up_recent_cpu(t))
+    fu_thread_compute_priority_advanced(t, NULL);
+  //a real-time thread waiting for its next period is only unblocked by
+  //fu_edf_release(), which gives it its new budget first
+  ASSERT(!t->b_edf_throttled);
+  if(thread_cfs && t->vruntime < min_vruntime - CFS_SLEEPER_CREDIT)
+    t->vruntime = min_vruntime - CFS_SLEEPER_CREDIT;
+  fu_ready_queue_push(t);
   t->status = THREAD_READY;
   //DO NOT place a call to thread_yield here, it will block the semaphores
   intr_set_level (old_level);
@@ -374,6 +596,13 @@ thread_exit (void)
      when it calls thread_schedule_tail(). */
   intr_disable ();
   list_remove (&thread_current()->allelem);
+  if (thread_current ()->b_edf)
+    {
+      edf_utilization -= fu_edf_utilization (thread_current ()->i64_edf_period,
+                                             thread_current ()->i64_edf_budget,
+                                             thread_current ()->i64_edf_deadline);
+      edf_thread_cnt--;
+    }
   thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
@@ -391,8 +620,16 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread) 
-    list_insert_ordered (&ready_list, &cur->elem, fu_comp_priority, NULL);
+  if (cur->b_edf_throttled)
+    {
+      /* A real-time thread out of budget sits out the rest of its
+         period. */
+      fu_edf_throttle ();
+      intr_set_level (old_level);
+      return;
+    }
+  if (cur != idle_thread)
+    fu_ready_queue_push (cur);
   cur->status = THREAD_READY;
   schedule ();
   if (cur != idle_thread)
@@ -444,33 +681,53 @@ fu_thread_get_priority(struct thread *t)
 
   if(thread_mlfqs)
   {
-    //the list of locks kept by a thread must be empty
-    ASSERT(list_empty(&t->l_locks_held));
-  }
-  //extract maximum
-  int i_max_list_priority = -1;
-  if(!list_empty(&t->l_locks_held))
-  {
-    i_max_list_priority = list_entry(list_front(&t->l_locks_held),
-                                     struct lock, le)->i_lock_priority;
-    ASSERT(m_valid_priority(i_max_list_priority));
+    //there is no donation under the advanced scheduler
+    ASSERT(t->donation_bitmap == 0);
   }
+  //the highest donation is the top of the donation heap
+  int i_max_donation = fu_priority_bitmap_max(t->donation_bitmap);
 
-  int i_new_priority = t->priority > i_max_list_priority ?
-                       t->priority : i_max_list_priority ;
+  int i_new_priority = t->priority > i_max_donation ?
+                       t->priority : i_max_donation ;
 
   ASSERT(m_valid_priority(i_new_priority));
 
   return i_new_priority;
 }
 
+//adds a priority donated to T through one of the locks it holds
+//called with interrupts turned off
+void
+fu_thread_donation_add(struct thread *t, int i_priority)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(m_valid_priority(i_priority));
+  ASSERT(t->donations[i_priority] < UINT8_MAX);
+
+  t->donations[i_priority]++;
+  t->donation_bitmap |= (uint64_t) 1 << i_priority;
+}
+
+//removes a priority previously donated to T
+//called with interrupts turned off
+void
+fu_thread_donation_remove(struct thread *t, int i_priority)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(m_valid_priority(i_priority));
+  ASSERT(t->donations[i_priority] > 0);
+
+  if(--t->donations[i_priority] == 0)
+    t->donation_bitmap &= ~((uint64_t) 1 << i_priority);
+}
+
 //calculates priority for the advanced scheduler
 static void
 fu_thread_compute_priority_advanced (struct thread *t, void *aux UNUSED)
 {
-  //this function can be called from an interrupt context by the scheduler
-  //or when a thread recomputes its nice value
-  ASSERT(t == thread_current() || intr_context());
+  //this function can be called from an interrupt context by the scheduler,
+  //when a thread recomputes its nice value or when a thread is unblocked
+  ASSERT(intr_get_level() == INTR_OFF);
   //the second term is supposed to be substracted from the first
   //instead of just dividing this function call does addition and division
   int64_t storage = fu_share_division(fu_introduce(PRI_MAX -
@@ -486,8 +743,193 @@ fu_thread_compute_priority_advanced (struct thread *t, void *aux UNUSED)
   else if(priority > PRI_MAX)
     priority = PRI_MAX;
 
+  if(priority == t->priority)
+    return;
+
   //changes a thread's priority
-  t->priority = priority;
+  //a ready thread has to move to the queue of its new priority
+  if(t->status == THREAD_READY)
+  {
+    fu_ready_queue_remove(t);
+    t->priority = priority;
+    fu_ready_queue_push(t);
+  }
+  else
+  {
+    t->priority = priority;
+  }
+}
+
+/* Makes the current thread a real-time thread which is released
+   every PERIOD ticks and must get BUDGET ticks of CPU time within
+   DEADLINE ticks of each release, with
+   0 < BUDGET <= DEADLINE <= PERIOD.  Its first period starts now.
+
+   Real-time threads are scheduled earliest deadline first, ahead
+   of all other threads.  A thread which runs out of budget is not
+   run again before its next period.  Returns false, leaving the
+   thread as it was, if admitting it would reserve more than 90%
+   of the CPU for real-time threads. */
+bool
+thread_set_edf (int64_t period, int64_t budget, int64_t deadline)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int64_t utilization;
+
+  ASSERT (!intr_context ());
+  ASSERT (0 < budget && budget <= deadline && deadline <= period);
+
+  old_level = intr_disable ();
+  utilization = edf_utilization
+                + fu_edf_utilization (period, budget, deadline);
+  if (cur->b_edf)
+    utilization -= fu_edf_utilization (cur->i64_edf_period,
+                                       cur->i64_edf_budget,
+                                       cur->i64_edf_deadline);
+  if (utilization > EDF_MAX_UTILIZATION)
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+  edf_utilization = utilization;
+  if (!cur->b_edf)
+    edf_thread_cnt++;
+
+  cur->b_edf = true;
+  cur->b_edf_throttled = false;
+  cur->i64_edf_period = period;
+  cur->i64_edf_budget = budget;
+  cur->i64_edf_deadline = deadline;
+  cur->i64_edf_next_release = timer_ticks ();
+  cur->i_edf_misses = 0;
+  fu_edf_replenish (cur);
+  intr_set_level (old_level);
+  return true;
+}
+
+/* Returns the current thread from the real-time class to the
+   scheduler it was in before. */
+void
+thread_clear_edf (void)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (cur->b_edf)
+    {
+      edf_utilization -= fu_edf_utilization (cur->i64_edf_period,
+                                             cur->i64_edf_budget,
+                                             cur->i64_edf_deadline);
+      edf_thread_cnt--;
+      cur->b_edf = false;
+    }
+  intr_set_level (old_level);
+  fu_necessary_to_yield ();
+}
+
+/* Marks the current job of the current real-time thread as done
+   and blocks until its next period, where the next job starts.
+   A job done after its deadline is counted as a deadline miss. */
+void
+thread_edf_wait_next_period (void)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (cur->b_edf);
+
+  old_level = intr_disable ();
+  if (timer_ticks () > cur->i64_edf_job_deadline)
+    cur->i_edf_misses++;
+  cur->b_edf_throttled = true;
+  if (cur->i64_edf_next_release > timer_ticks ())
+    fu_edf_throttle ();
+  else
+    fu_edf_replenish (cur);
+  intr_set_level (old_level);
+}
+
+/* Returns the number of jobs of the current real-time thread that
+   finished after their deadline. */
+int
+thread_edf_misses (void)
+{
+  return thread_current ()->i_edf_misses;
+}
+
+/* Returns the tick at which the first real-time thread blocked
+   until its next period is due, or INT64_MAX if there is none.
+   Must be called with interrupts off. */
+int64_t
+thread_edf_next_release (void)
+{
+  struct list_elem *e;
+  int64_t next = INT64_MAX;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (e = list_begin (&edf_throttled_list);
+       e != list_end (&edf_throttled_list); e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, elem);
+      if (t->i64_edf_next_release < next)
+        next = t->i64_edf_next_release;
+    }
+  return next;
+}
+
+/* Makes ready the real-time threads whose next period has
+   started.  For the timer, which calls it after catching up on
+   the ticks missed while the CPU was idle.  Must be called with
+   interrupts off. */
+void
+thread_edf_release (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  fu_edf_release ();
+}
+
+/* Stores the scheduler accounting of the running thread in
+   USAGE, including the time it has run since it was last
+   scheduled. */
+void
+thread_get_rusage (struct rusage *usage)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (usage != NULL);
+
+  old_level = intr_disable ();
+  usage->run_us = fu_cycles_to_us (thread_run_cycles ());
+  usage->wait_us = fu_cycles_to_us (cur->ui64_wait_cycles);
+  usage->lock_wait_us = fu_cycles_to_us (cur->ui64_lock_wait_cycles);
+  usage->voluntary_switches = cur->ui32_voluntary_switches;
+  usage->involuntary_switches = cur->ui32_involuntary_switches;
+  usage->lock_blocks = cur->ui32_lock_blocks;
+  usage->reserved = 0;
+  intr_set_level (old_level);
+}
+
+/* Returns the TSC cycles the running thread has spent on the
+   CPU, including the time since it was last scheduled.  Unlike
+   the TSC itself, this does not advance while the thread is
+   blocked or ready. */
+uint64_t
+thread_run_cycles (void)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  uint64_t run_cycles;
+
+  old_level = intr_disable ();
+  run_cycles = (cur->ui64_run_cycles
+                + (timer_cycles () - cur->ui64_acct_since));
+  intr_set_level (old_level);
+  return run_cycles;
 }
 
 /* Sets the current thread's nice value to NICE. */
@@ -495,8 +937,13 @@ void
 thread_set_nice (int nice) 
 {
   ASSERT(!intr_context());
+  enum intr_level old_level = intr_disable();
   thread_current()->nice = nice;
-  fu_thread_compute_priority_advanced(thread_current(), NULL);
+  //the completely fair scheduler reads the weight off the nice value when
+  //the thread is queued again
+  if(!thread_cfs)
+    fu_thread_compute_priority_advanced(thread_current(), NULL);
+  intr_set_level(old_level);
   //if it doesn't have the highest priority any longer, it yields
   fu_necessary_to_yield();
 }
@@ -523,7 +970,7 @@ fu_thread_compute_load_avg (void)
   ASSERT(intr_context());
   //counts ready and running threads
   //excludes the idle thread from the cpu load_avg computation
-  int i_thread_count = list_size(&ready_list);
+  int i_thread_count = ready_cnt;
   if(thread_current() != idle_thread)
   {
     i_thread_count += 1;
@@ -545,24 +992,89 @@ thread_get_recent_cpu (void)
   return fu_adjust(thread_current()->recent_cpu);
 }
 
-//computes the load average
-//for a given thread
-//called from interrupt context so there is no need to synchronize with
-//thread_get_average
-void
-fu_thread_compute_recent_cpu (struct thread *t, void *aux UNUSED)
+//called every second from interrupt context
+//computes the load average and the decay coefficient of this second, then
+//decays recent_cpu of the running and ready threads only
+//blocked threads are left alone until they are unblocked
+static void
+fu_thread_mlfqs_second (void)
 {
-  //this function is called from an interrupt context
   ASSERT(intr_context());
+
+  fu_thread_compute_load_avg();
+  //optimization barrier - the decay coefficient depends on the new load_avg
+  barrier();
+
   //the decay coefficient based on load_avg
-  int64_t i64_load_decay = 
+  decay_history[decay_epoch % DECAY_HISTORY] =
     fu_rounding_division(load_avg * RCPU_ON_LOADAVG,
                          load_avg * RCPU_ON_LOADAVG + fu_introduce(1),
                          true);
-  //computes recent_cpu
-  t->recent_cpu = fu_share_division(fu_introduce(thread_get_nice()),
-                                    t->recent_cpu * i64_load_decay,
-                                    MULTIPLICATION);
+  decay_epoch++;
+
+  struct thread *cur = thread_current();
+  if(cur != idle_thread)
+  {
+    fu_thread_catch_up_recent_cpu(cur);
+    fu_thread_compute_priority_advanced(cur, NULL);
+  }
+
+  int i;
+  for(i = PRI_MIN; i <= PRI_MAX; i++)
+  {
+    struct list_elem *e = list_begin(&ready_queues[i]);
+    while(e != list_end(&ready_queues[i]))
+    {
+      struct thread *t = list_entry(e, struct thread, elem);
+      //the thread might be moved to another queue by its new priority
+      e = list_next(e);
+      //a thread moved to a queue not yet visited is already up to date
+      if(fu_thread_catch_up_recent_cpu(t))
+        fu_thread_compute_priority_advanced(t, NULL);
+    }
+  }
+}
+
+//applies to T every decay since its recent_cpu was last brought up to date
+//returns false if there was nothing to apply
+//a thread blocked for longer than DECAY_HISTORY seconds has its oldest missed
+//decays approximated by the oldest coefficient still remembered
+static bool
+fu_thread_catch_up_recent_cpu (struct thread *t)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(t != NULL);
+
+  uint32_t ui32_missed = decay_epoch - t->recent_cpu_epoch;
+  uint32_t ui32_epoch = t->recent_cpu_epoch;
+
+  if(ui32_missed == 0)
+    return false;
+
+  if(ui32_missed > DECAY_HISTORY)
+  {
+    //the value converges long before the extra decays run out,
+    //so the work done at wake up stays bounded
+    uint32_t ui32_extra = ui32_missed - DECAY_HISTORY;
+    if(ui32_extra > DECAY_HISTORY)
+      ui32_extra = DECAY_HISTORY;
+
+    ui32_epoch = decay_epoch - DECAY_HISTORY;
+    int64_t i64_oldest_decay = decay_history[ui32_epoch % DECAY_HISTORY];
+    while(ui32_extra-- > 0)
+      t->recent_cpu = fu_share_division(fu_introduce(t->nice),
+                                        t->recent_cpu * i64_oldest_decay,
+                                        MULTIPLICATION);
+  }
+
+  for(; ui32_epoch != decay_epoch; ui32_epoch++)
+    t->recent_cpu = fu_share_division(fu_introduce(t->nice),
+                                      t->recent_cpu *
+                                      decay_history[ui32_epoch % DECAY_HISTORY],
+                                      MULTIPLICATION);
+
+  t->recent_cpu_epoch = decay_epoch;
+  return true;
 }
 
 
@@ -588,6 +1100,10 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* In tickless mode, stop the periodic tick until the next
+         sleeper is due. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -604,6 +1120,33 @@ idle (void *idle_started_ UNUSED)
     }
 }
 
+/* Frees the pages of the cache of thread pages beyond the first
+   THREAD_PAGE_CACHE_MAX, oldest first.  Freeing a page takes the
+   pool lock, which the scheduler cannot do itself, so it queues
+   this work instead. */
+static void
+thread_page_trim (void *aux UNUSED) 
+{
+  for (;;) 
+    {
+      enum intr_level old_level;
+      struct thread *t = NULL;
+
+      old_level = intr_disable ();
+      if (thread_page_cache_cnt > THREAD_PAGE_CACHE_MAX)
+        {
+          t = list_entry (list_pop_back (&thread_page_cache),
+                          struct thread, elem);
+          thread_page_cache_cnt--;
+        }
+      intr_set_level (old_level);
+
+      if (t == NULL)
+        break;
+      palloc_free_page (t);
+    }
+}
+
 /* Function used as the basis for a kernel thread. */
 static void
 kernel_thread (thread_func *function, void *aux) 
@@ -654,6 +1197,9 @@ init_thread (struct thread *t, const char *name, int priority)
   t->priority = priority;
   t->magic = THREAD_MAGIC;
   t->recent_cpu = 0;
+  t->recent_cpu_epoch = decay_epoch;
+  t->ui64_acct_since = timer_cycles ();
+  t->vruntime = min_vruntime;
 
   // Initialises values used for SYSCALLs
   #ifdef USERPROG
@@ -695,9 +1241,11 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
+  struct thread *t = fu_ready_queue_pop ();
+
+  if (t == NULL)
     return idle_thread;
-  return list_entry (list_pop_front (&ready_list), struct thread, elem);
+  return t;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -734,15 +1282,14 @@ thread_schedule_tail (struct thread *prev)
   process_activate ();
 #endif
 
-  /* If the thread we switched from is dying, destroy its struct
-     thread.  This must happen late so that thread_exit() doesn't
-     pull out the rug under itself.  (We don't free
-     initial_thread because its memory was not obtained via
-     palloc().) */
+  /* If the thread we switched from is dying, recycle its page.
+     This must happen late so that thread_exit() doesn't pull out
+     the rug under itself.  (We don't recycle initial_thread
+     because its memory was not obtained via palloc().) */
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      fu_thread_page_put (prev);
     }
 }
 
@@ -764,8 +1311,16 @@ schedule (void)
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  /* Restart the periodic tick if the idle thread stopped it. */
+  if (cur == idle_thread)
+    timer_idle_exit ();
+
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      trace_event (TRACE_SCHEDULE, next->tid, 0, 0);
+      fu_thread_account_switch (cur, next);
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
@@ -787,53 +1342,6 @@ allocate_tid (void)
    Used by switch.S, which can't figure it out on its own. */
 uint32_t thread_stack_ofs = offsetof (struct thread, stack);
 
-//comparison function for ready_list and lists held by locks
-//the list which it will sort is the third parameter
-////TODO change name to fu_lcomp_priority
-bool
-fu_comp_priority(const struct list_elem *a,
-                 const struct list_elem *b,
-                 void *aux UNUSED)
-{
-  ASSERT(a != NULL);
-  ASSERT(b != NULL);
-
-  if(aux != NULL)
-  {
-    //this must have been called from within a condition
-    struct semaphore_elem *s_a = list_entry(a, struct semaphore_elem, elem);
-    struct semaphore_elem *s_b = list_entry(b, struct semaphore_elem, elem);
-
-    uint32_t ui32_s_a_size = list_size(&s_a->semaphore.waiters);
-    uint32_t ui32_s_b_size = list_size(&s_b->semaphore.waiters);
-
-    //in case a semaphore does not have any elements
-    if(ui32_s_a_size == 0)
-    {
-      return false;
-    }
-    else if(ui32_s_b_size == 0)
-    {
-      return true;
-    }
-
-    ASSERT(ui32_s_a_size == 1);
-    ASSERT(ui32_s_b_size == 1);
-    a = list_front(&s_a->semaphore.waiters);
-    b = list_front(&s_b->semaphore.waiters);
-  }
-  //obtains the threads which are encompassing those elements
-  struct thread *t_a = list_entry(a, struct thread, elem);
-  struct thread *t_b = list_entry(b, struct thread, elem);
-
-  ASSERT(t_a != NULL);
-  ASSERT(t_b != NULL);
-
-  //establishes decresing ordering
-  return fu_thread_get_priority(t_a) >
-         fu_thread_get_priority(t_b);
-}
-
 //this function has to be executed atomically,
 //otherwise the thread from the top of the list will be removed from its
 //position during an interrupt
@@ -841,17 +1349,32 @@ void
 fu_necessary_to_yield(void)
 {
   enum intr_level old_level = intr_disable();
-  if(!list_empty(&ready_list))
+  struct thread *cur = thread_current();
+  //the real-time class comes first, and its threads are not preempted by
+  //threads of the other classes
+  bool b_edf = cur->b_edf || fu_edf_first() != NULL;
+  if(b_edf || thread_cfs)
+  {
+    bool b_preempt = b_edf ? fu_edf_should_preempt(cur)
+                           : fu_cfs_should_preempt(cur);
+    if(b_preempt && intr_context())
+      intr_yield_on_return();
+    intr_set_level(old_level);
+    if(b_preempt && !intr_context())
+      thread_yield();
+    return;
+  }
+  int i_max_priority = fu_ready_queue_max_priority();
+  if(i_max_priority >= 0)
   {
-    struct thread *t = list_entry(list_front(&ready_list), struct thread, elem);
     if(intr_context() == true)
     {
-      if(fu_thread_get_priority(t) >= thread_get_priority())
+      if(i_max_priority >= thread_get_priority())
       {
         intr_yield_on_return();
       }
     }
-    else if(fu_thread_get_priority(t) > thread_get_priority())
+    else if(i_max_priority > thread_get_priority())
     {
       //have to set interrupts to old level before yielding
       intr_set_level(old_level);
@@ -870,7 +1393,382 @@ void fu_thread_reinsert_ready_list(struct thread *t)
   ASSERT(intr_get_level() == INTR_OFF);
   ASSERT(t != NULL);
   ASSERT(t->status == THREAD_READY);
-  list_remove(&t->elem);
-  list_insert_ordered(&ready_list, &t->elem, fu_comp_priority, NULL);
+  //nothing to do if the effective priority did not change, or if it does
+  //not decide the order of the ready threads
+  if(thread_cfs || t->b_edf ||
+     t->i_ready_priority == fu_thread_get_priority(t))
+    return;
+  fu_ready_queue_remove(t);
+  fu_ready_queue_push(t);
   return;
 }
+
+//appends a thread at the back of the queue of its effective priority so that
+//threads of equal priority are scheduled in FIFO order
+static void
+fu_ready_queue_push(struct thread *t)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(t != NULL);
+
+  int i_priority = fu_thread_get_priority(t);
+  t->i_ready_priority = i_priority;
+  ready_cnt++;
+  if(t->b_edf)
+  {
+    rb_insert(&edf_tree, &t->rb_elem);
+    return;
+  }
+  if(thread_cfs)
+  {
+    rb_insert(&cfs_tree, &t->rb_elem);
+    cfs_weight += fu_cfs_weight(t);
+    return;
+  }
+  list_push_back(&ready_queues[i_priority], &t->elem);
+  ready_bitmap |= (uint64_t) 1 << i_priority;
+}
+
+//removes a thread from the queue it was pushed into
+//(not necessarily its current priority)
+static void
+fu_ready_queue_remove(struct thread *t)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(t != NULL);
+  ASSERT(m_valid_priority(t->i_ready_priority));
+  ASSERT(ready_cnt > 0);
+
+  ready_cnt--;
+  if(t->b_edf)
+  {
+    rb_remove(&edf_tree, &t->rb_elem);
+    return;
+  }
+  if(thread_cfs)
+  {
+    rb_remove(&cfs_tree, &t->rb_elem);
+    cfs_weight -= fu_cfs_weight(t);
+    return;
+  }
+  list_remove(&t->elem);
+  if(list_empty(&ready_queues[t->i_ready_priority]))
+    ready_bitmap &= ~((uint64_t) 1 << t->i_ready_priority);
+}
+
+//finds the highest non-empty queue
+static int
+fu_ready_queue_max_priority(void)
+{
+  return fu_priority_bitmap_max(ready_bitmap);
+}
+
+//scans a bitmap of priorities for its most significant bit, one 32-bit half
+//at a time
+static int
+fu_priority_bitmap_max(uint64_t ui64_bitmap)
+{
+  uint32_t ui32_high = ui64_bitmap >> 32;
+  uint32_t ui32_low = ui64_bitmap;
+
+  if(ui32_high != 0)
+    return 63 - __builtin_clz(ui32_high);
+  if(ui32_low != 0)
+    return 31 - __builtin_clz(ui32_low);
+  return -1;
+}
+
+//removes the thread at the front of the highest non-empty queue
+static struct thread *
+fu_ready_queue_pop(void)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  struct thread *t = NULL;
+
+  t = fu_edf_first();
+  if(t != NULL)
+  {
+    //a real-time thread is ready
+  }
+  else if(thread_cfs)
+  {
+    t = fu_cfs_first();
+  }
+  else
+  {
+    int i_max_priority = fu_ready_queue_max_priority();
+    if(i_max_priority >= 0)
+      t = list_entry(list_front(&ready_queues[i_max_priority]),
+                     struct thread, elem);
+  }
+  if(t != NULL)
+    fu_ready_queue_remove(t);
+  return t;
+}
+
+static int32_t
+fu_cfs_weight(struct thread *t)
+{
+  int i_index = t->nice + 20;
+  if(i_index < 0)
+    i_index = 0;
+  else if(i_index > 40)
+    i_index = 40;
+  return cfs_weights[i_index];
+}
+
+//threads with equal virtual runtimes are kept in the order they were queued
+static bool
+fu_cfs_less(const struct rb_elem *a, const struct rb_elem *b,
+            void *aux UNUSED)
+{
+  return rb_entry(a, struct thread, rb_elem)->vruntime
+         < rb_entry(b, struct thread, rb_elem)->vruntime;
+}
+
+static struct thread *
+fu_cfs_first(void)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  struct rb_elem *e = rb_first(&cfs_tree);
+  return e != NULL ? rb_entry(e, struct thread, rb_elem) : NULL;
+}
+
+static void
+fu_cfs_charge_tick(struct thread *t)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  t->vruntime += CFS_TICK_NS * CFS_NICE_0_WEIGHT / fu_cfs_weight(t);
+
+  int64_t i64_min = t->vruntime;
+  struct thread *first = fu_cfs_first();
+  if(first != NULL && first->vruntime < i64_min)
+    i64_min = first->vruntime;
+  if(i64_min > min_vruntime)
+    min_vruntime = i64_min;
+}
+
+//the scheduling period is CFS_LATENCY ticks, or CFS_MIN_SLICE per runnable
+//thread if that is longer, and is shared out in proportion to the weights
+static unsigned
+fu_cfs_slice(struct thread *t)
+{
+  int64_t i64_nr_running = ready_cnt + 1;
+  int64_t i64_period = CFS_LATENCY;
+  if(i64_nr_running * CFS_MIN_SLICE > i64_period)
+    i64_period = i64_nr_running * CFS_MIN_SLICE;
+
+  int64_t i64_weight = fu_cfs_weight(t);
+  int64_t i64_slice = i64_period * i64_weight / (cfs_weight + i64_weight);
+  return i64_slice > CFS_MIN_SLICE ? i64_slice : CFS_MIN_SLICE;
+}
+
+//the idle thread gives way to anything, other threads only to a thread
+//which is behind by more than the wake up granularity, so that threads
+//waking up in a row do not keep switching the CPU back and forth
+static bool
+fu_cfs_should_preempt(struct thread *t)
+{
+  struct thread *first = fu_cfs_first();
+  if(first == NULL)
+    return false;
+  if(t == idle_thread)
+    return true;
+  return first->vruntime + CFS_WAKEUP_GRANULARITY < t->vruntime;
+}
+
+//threads with equal deadlines are kept in the order they were queued
+static bool
+fu_edf_less(const struct rb_elem *a, const struct rb_elem *b,
+            void *aux UNUSED)
+{
+  return rb_entry(a, struct thread, rb_elem)->i64_edf_abs_deadline
+         < rb_entry(b, struct thread, rb_elem)->i64_edf_abs_deadline;
+}
+
+static struct thread *
+fu_edf_first(void)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  struct rb_elem *e = rb_first(&edf_tree);
+  return e != NULL ? rb_entry(e, struct thread, rb_elem) : NULL;
+}
+
+static bool
+fu_edf_should_preempt(struct thread *t)
+{
+  struct thread *first = fu_edf_first();
+  if(first == NULL)
+    return false;
+  if(!t->b_edf)
+    return true;
+  return first->i64_edf_abs_deadline < t->i64_edf_abs_deadline;
+}
+
+//a thread which finished its job starts a new one, with a new deadline
+//a thread which ran out of budget carries on with the job it was doing;
+//it is told apart by having no budget left, since a finished job is
+//reported before the budget runs out
+//periods that went by entirely while the thread could not run are skipped
+static void
+fu_edf_replenish(struct thread *t)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(t->b_edf);
+
+  int64_t i64_now = timer_ticks();
+  int64_t i64_release = t->i64_edf_next_release;
+  while(i64_release + t->i64_edf_period <= i64_now)
+    i64_release += t->i64_edf_period;
+
+  bool b_new_job = !t->b_edf_throttled ||
+                   t->i64_edf_budget_left > 0;
+  t->i64_edf_abs_deadline = i64_release + t->i64_edf_deadline;
+  if(b_new_job)
+    t->i64_edf_job_deadline = t->i64_edf_abs_deadline;
+  t->i64_edf_budget_left = t->i64_edf_budget;
+  t->i64_edf_next_release = i64_release + t->i64_edf_period;
+  t->b_edf_throttled = false;
+}
+
+//the thread is not on any other list while it is throttled: it is not ready,
+//and it does not wait for anything but its next period
+static void
+fu_edf_throttle(void)
+{
+  struct thread *t = thread_current();
+
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(t->b_edf && t->b_edf_throttled);
+
+  list_push_back(&edf_throttled_list, &t->elem);
+  thread_block();
+}
+
+static void
+fu_edf_release(void)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  int64_t i64_now = timer_ticks();
+  struct list_elem *e = list_begin(&edf_throttled_list);
+  while(e != list_end(&edf_throttled_list))
+  {
+    struct thread *t = list_entry(e, struct thread, elem);
+    e = list_next(e);
+    if(t->i64_edf_next_release <= i64_now)
+    {
+      list_remove(&t->elem);
+      fu_edf_replenish(t);
+      thread_unblock(t);
+    }
+  }
+}
+
+//a thread's density is its budget over the shorter of its deadline and
+//period; admission keeps the sum of the densities bounded, which is enough
+//for every real-time thread to meet its deadlines
+static int64_t
+fu_edf_utilization(int64_t i64_period, int64_t i64_budget,
+                   int64_t i64_deadline)
+{
+  int64_t i64_window = i64_deadline < i64_period ? i64_deadline : i64_period;
+  return i64_budget * 1000000 / i64_window;
+}
+
+//the page of a thread which exited is reused as it is: init_thread() clears
+//the struct thread, and the stack needs no zeroing
+static struct thread *
+fu_thread_page_get(void)
+{
+  struct thread *t = NULL;
+
+  enum intr_level old_level = intr_disable();
+  if(!list_empty(&thread_page_cache))
+  {
+    t = list_entry(list_pop_front(&thread_page_cache), struct thread, elem);
+    thread_page_cache_cnt--;
+  }
+  intr_set_level(old_level);
+
+  if(t == NULL)
+    t = palloc_get_page(PAL_ZERO);
+  return t;
+}
+
+//called by the scheduler, so it only links the page in and queues the
+//work which trims the cache if it grew too big
+//the dead thread's elem is free to link it, since it is on no other list
+static void
+fu_thread_page_put(struct thread *t)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(t->status == THREAD_DYING);
+
+  //a stale pointer to the dead thread must not pass for a thread
+  t->magic = 0;
+
+  list_push_front(&thread_page_cache, &t->elem);
+  thread_page_cache_cnt++;
+  bool b_trim = thread_page_cache_cnt > THREAD_PAGE_CACHE_MAX;
+
+  if(b_trim)
+    work_queue(&thread_page_trim_work);
+}
+
+//charges the time since the last switch to the thread leaving the CPU and to
+//the one taking it
+//called by the scheduler with interrupts off
+static void
+fu_thread_account_switch(struct thread *cur, struct thread *next)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  uint64_t ui64_now = timer_cycles();
+
+  cur->ui64_run_cycles += ui64_now - cur->ui64_acct_since;
+  cur->ui64_acct_since = ui64_now;
+  if(cur->status == THREAD_BLOCKED)
+    cur->ui32_voluntary_switches++;
+  else if(cur->status == THREAD_READY)
+    cur->ui32_involuntary_switches++;
+
+  //the idle thread is never on a run queue, so it never waits
+  if(next != idle_thread)
+    next->ui64_wait_cycles += ui64_now - next->ui64_acct_since;
+  next->ui64_acct_since = ui64_now;
+}
+
+//converts TSC cycles to microseconds, or 0 if the TSC is not calibrated yet
+static int64_t
+fu_cycles_to_us(uint64_t ui64_cycles)
+{
+  uint64_t ui64_hz = timer_cycles_per_sec();
+
+  if(ui64_hz == 0)
+    return 0;
+  //whole seconds first, so that the multiplication cannot overflow
+  return ui64_cycles / ui64_hz * 1000000
+         + ui64_cycles % ui64_hz * 1000000 / ui64_hz;
+}
+
+//prints the scheduler accounting of a thread
+static void
+fu_thread_print_rusage(struct thread *t, void *aux UNUSED)
+{
+  uint64_t ui64_run_cycles = t->ui64_run_cycles;
+
+  //the running thread has not been charged for its current run yet
+  if(t->status == THREAD_RUNNING)
+    ui64_run_cycles += timer_cycles() - t->ui64_acct_since;
+  printf("  %5d %-16s %10"PRId64" %10"PRId64" %7"PRIu32" %7"PRIu32
+         " %7"PRIu32" %10"PRId64"\n", t->tid, t->name,
+         fu_cycles_to_us(ui64_run_cycles),
+         fu_cycles_to_us(t->ui64_wait_cycles), t->ui32_voluntary_switches,
+         t->ui32_involuntary_switches, t->ui32_lock_blocks,
+         fu_cycles_to_us(t->ui64_lock_wait_cycles));
+}
@@ -3,6 +3,8 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
+#include <rusage.h>
 #include <stdint.h>
 #include "devices/timer.h"
 #include "threads/synch.h"
@@ -25,6 +27,7 @@ typedef int tid_t;
 #define PRI_MIN 0                       /* Lowest priority. */
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1) /* Number of priority levels. */
 #define m_valid_priority(p) (PRI_MIN <= p && p <= PRI_MAX)
 
 /* A kernel thread or user process.
@@ -91,10 +94,22 @@ struct thread
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
-    //list containing all locks held by the thread
-    //even those with lower priority just in case this thread lowers its
-    //priority
-    struct list l_locks_held;
+    //effective priority the thread was queued with while THREAD_READY
+    int i_ready_priority;
+    //priorities donated through the locks held by the thread: the number
+    //of held locks with waiters at each priority, and a bitmap of the
+    //non-zero counts whose most significant bit is the highest donation
+    uint8_t donations[PRI_CNT];
+    uint64_t donation_bitmap;
+    //lock the thread is blocked on, which passes donations further down
+    //a nested chain of holders
+    struct lock *l_waiting_on;
+    //wait queue of the semaphore, lock or condition the thread is blocked
+    //on, the element it is queued with and the priority it is queued at,
+    //so that a donation can move it up the queue
+    struct plist *pl_waiting_on;
+    struct list_elem *le_waiting;
+    int i_wait_priority;
     struct list_elem allelem;           /* List element for all threads list. */
 
     //nice value of a thread
@@ -102,6 +117,51 @@ struct thread
     //how many resources has the thread used recently
     ////has to be initialized to 0
     int64_t recent_cpu;
+    //number of decays already applied to recent_cpu
+    uint32_t recent_cpu_epoch;
+    //weighted running time for the completely fair scheduler, in ns
+    int64_t vruntime;
+    //element of the run queue of the completely fair scheduler, or of the
+    //real-time class
+    struct rb_elem rb_elem;
+
+    //earliest-deadline-first parameters and state, in timer ticks
+    //(only meaningful while b_edf is true)
+    bool b_edf;
+    //out of budget, or done with its job, until the next period starts
+    bool b_edf_throttled;
+    int64_t i64_edf_period;
+    int64_t i64_edf_budget;
+    //deadline relative to the start of each period
+    int64_t i64_edf_deadline;
+    int64_t i64_edf_budget_left;
+    //deadline the real-time threads are ordered by
+    int64_t i64_edf_abs_deadline;
+    //deadline of the job in progress, which may be earlier than the one
+    //above if the job was throttled
+    int64_t i64_edf_job_deadline;
+    int64_t i64_edf_next_release;
+    //number of jobs done after their deadline
+    int i_edf_misses;
+
+    //scheduler accounting, in TSC cycles: time spent running and time spent
+    //ready waiting for a CPU, and when the thread last started to do either
+    uint64_t ui64_run_cycles;
+    uint64_t ui64_wait_cycles;
+    uint64_t ui64_acct_since;
+    //switches away from the thread because it blocked, and because it was
+    //preempted or yielded
+    uint32_t ui32_voluntary_switches;
+    uint32_t ui32_involuntary_switches;
+    //times the thread blocked on a held lock, and how long it waited
+    uint32_t ui32_lock_blocks;
+    uint64_t ui64_lock_wait_cycles;
+
+    /* Owned by devices/timer.c. */
+    struct list_elem le_sleep;          /* Timing wheel slot element. */
+    int64_t wake_time;                  /* Tick to wake up at. */
+    int64_t wake_ns;                    /* Sub-tick sleep deadline. */
+    bool b_sleeping;                    /* In timer_sleep()? */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
@@ -129,6 +189,10 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
 void thread_init (void);
 void thread_start (void);
 
@@ -157,6 +221,20 @@ void thread_set_priority (int);
 
 //gets another thread's priority
 int fu_thread_get_priority(struct thread *t);
+//adds or removes a priority donated to T through one of the locks it holds
+void fu_thread_donation_add(struct thread *t, int i_priority);
+void fu_thread_donation_remove(struct thread *t, int i_priority);
+
+/* Earliest-deadline-first real-time class. */
+bool thread_set_edf (int64_t period, int64_t budget, int64_t deadline);
+void thread_clear_edf (void);
+void thread_edf_wait_next_period (void);
+int thread_edf_misses (void);
+int64_t thread_edf_next_release (void);
+void thread_edf_release (void);
+
+void thread_get_rusage (struct rusage *);
+uint64_t thread_run_cycles (void);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
@@ -167,11 +245,6 @@ int thread_get_load_avg (void);
 //if a thread is on the ready list and its priority changes
 void fu_thread_reinsert_ready_list(struct thread *t);
 
-//comparison function for ready list and for lists used by locks
-bool fu_comp_priority(const struct list_elem *a,
-                      const struct list_elem *b,
-                      void *aux UNUSED);
-
 //if the current thread no longer has the maximum priority, it will yield
 void fu_necessary_to_yield(void);
 
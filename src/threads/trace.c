@@ -0,0 +1,203 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef FILESYS
+#include "filesys/fsutil.h"
+#endif
+
+/* Size of the trace buffer.  Its first slot is kept for the
+   header, so that the file can be written out in place. */
+#define TRACE_PAGES 32
+
+bool trace_enabled;
+
+static struct trace_event *slots;  /* Header slot, then the ring. */
+static struct trace_event *events; /* The ring, or NULL if not tracing. */
+static size_t event_cnt;        /* Number of events the ring holds. */
+static size_t next;             /* Index of the next event to record. */
+static bool wrapped;            /* Has the ring filled up? */
+static uint32_t lost_cnt;       /* Events overwritten. */
+
+static struct trace_event *record (enum trace_type);
+static tid_t running_tid (void);
+static void reverse (struct trace_event *, size_t cnt);
+
+/* Allocates the trace buffer and starts tracing, if -trace was
+   given.  Called once the page allocator is up. */
+void
+trace_init (void)
+{
+  ASSERT (sizeof (struct trace_header) == sizeof (struct trace_event));
+
+  if (!trace_enabled)
+    return;
+
+  slots = palloc_get_multiple (0, TRACE_PAGES);
+  if (slots == NULL)
+    PANIC ("trace: no memory for the trace buffer");
+  event_cnt = TRACE_PAGES * PGSIZE / sizeof *slots - 1;
+  events = slots + 1;
+  trace_thread_name (thread_current ()->tid, thread_current ()->name);
+}
+
+/* Records an event of the given TYPE with arguments ARG0, ARG1
+   and ARG2.  May be called in any context, including within an
+   interrupt handler and with the running thread half-way
+   through blocking. */
+void
+trace_event (enum trace_type type, uint32_t arg0, uint32_t arg1,
+             uint32_t arg2)
+{
+  enum intr_level old_level;
+  struct trace_event *e;
+
+  /* Tracepoints should cost next to nothing without -trace. */
+  if (events == NULL)
+    return;
+
+  old_level = intr_disable ();
+  e = record (type);
+  if (e != NULL)
+    {
+      e->arg[0] = arg0;
+      e->arg[1] = arg1;
+      e->arg[2] = arg2;
+      e->arg[3] = 0;
+    }
+  intr_set_level (old_level);
+}
+
+/* Records that thread TID is named NAME, which the timeline
+   shows instead of the bare tid.  Only the first 11 characters
+   of the name are kept. */
+void
+trace_thread_name (tid_t tid, const char *name)
+{
+  enum intr_level old_level;
+  struct trace_event *e;
+
+  if (events == NULL)
+    return;
+
+  old_level = intr_disable ();
+  e = record (TRACE_THREAD_NAME);
+  if (e != NULL)
+    {
+      e->arg[0] = tid;
+      strlcpy ((char *) &e->arg[1], name, sizeof e->arg - sizeof e->arg[0]);
+    }
+  intr_set_level (old_level);
+}
+
+/* Stops tracing and appends the trace, oldest event first, to
+   the ustar archive on the scratch device as file "trace".
+   Called at shutdown. */
+void
+trace_dump (void)
+{
+  struct trace_header *h = (struct trace_header *) slots;
+  enum intr_level old_level;
+  size_t cnt;
+
+  old_level = intr_disable ();
+  if (events == NULL)
+    {
+      intr_set_level (old_level);
+      return;
+    }
+  events = NULL;
+  intr_set_level (old_level);
+
+  /* Rotate the ring so that the oldest event comes first. */
+  cnt = wrapped ? event_cnt : next;
+  if (wrapped)
+    {
+      reverse (slots + 1, next);
+      reverse (slots + 1 + next, event_cnt - next);
+      reverse (slots + 1, event_cnt);
+    }
+
+  memset (h, 0, sizeof *h);
+  memcpy (h->magic, TRACE_MAGIC, sizeof h->magic);
+  h->version = TRACE_VERSION;
+  h->event_cnt = cnt;
+  h->tsc_hz = timer_cycles_per_sec ();
+  h->lost_cnt = lost_cnt;
+
+#ifdef FILESYS
+  /* Writing to the disk takes locks and sleeps. */
+  if (intr_context () || intr_get_level () == INTR_OFF)
+    printf ("Trace: %zu events not saved with interrupts off.\n", cnt);
+  else if (!fsutil_append_buffer ("trace", slots,
+                                  (cnt + 1) * sizeof *slots))
+    printf ("Trace: %zu events not saved: no room on scratch device.\n",
+            cnt);
+  else
+    printf ("Trace: %zu events saved to scratch device, %"PRIu32
+            " lost.\n", cnt, lost_cnt);
+#else
+  printf ("Trace: %zu events not saved: no scratch device.\n", cnt);
+#endif
+}
+
+/* Returns the slot for a new event of the given TYPE, stamped
+   and attributed to the running thread, or a null pointer if
+   not tracing.  Interrupts must be off. */
+static struct trace_event *
+record (enum trace_type type)
+{
+  struct trace_event *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (events == NULL)
+    return NULL;
+  e = &events[next];
+  if (wrapped)
+    lost_cnt++;
+  if (++next == event_cnt)
+    {
+      next = 0;
+      wrapped = true;
+    }
+
+  e->tsc = timer_cycles ();
+  e->type = type;
+  e->tid = running_tid ();
+  return e;
+}
+
+/* Returns the tid of the running thread.  Like running_thread()
+   in thread.c, this finds the thread from the stack pointer,
+   since thread_current() asserts that the thread is running,
+   which it no longer is half-way through blocking.  Interrupt
+   handlers run on the stack of the thread they interrupted. */
+static tid_t
+running_tid (void)
+{
+  uint32_t *esp;
+
+  asm ("mov %%esp, %0" : "=g" (esp));
+  return ((struct thread *) pg_round_down (esp))->tid;
+}
+
+/* Reverses the order of the CNT events starting at E. */
+static void
+reverse (struct trace_event *e, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt / 2; i++)
+    {
+      struct trace_event t = e[i];
+      e[i] = e[cnt - 1 - i];
+      e[cnt - 1 - i] = t;
+    }
+}
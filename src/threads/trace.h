@@ -0,0 +1,68 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel event trace.
+
+   With -trace, tracepoints throughout the kernel record events
+   in a ring buffer, as fixed-size binary records stamped with
+   the TSC, without printing anything.  When the buffer is full
+   the oldest events are overwritten.  At shutdown the buffer is
+   appended to the ustar archive on the scratch device as a file
+   named "trace", which `pintos --trace=FILE' copies out and
+   utils/trace-timeline turns into a readable timeline.
+
+   The file starts with a struct trace_header, followed by the
+   events, oldest first.  All fields are little-endian. */
+
+/* Types of events, and the meaning of their arguments. */
+enum trace_type
+  {
+    TRACE_THREAD_NAME,          /* ARG[0] is a tid, ARG[1...3] its name. */
+    TRACE_SCHEDULE,             /* Switch to thread ARG[0]. */
+    TRACE_BLOCK,                /* Thread blocks. */
+    TRACE_UNBLOCK,              /* Thread ARG[0] unblocked. */
+    TRACE_LOCK_ACQUIRE,         /* Lock ARG[0] acquired after waiting
+                                   ARG[1] TSC cycles. */
+    TRACE_BLOCK_READ,           /* Sector ARG[0] of the block device of
+                                   type ARG[1] read in ARG[2] cycles. */
+    TRACE_BLOCK_WRITE,          /* Same for a write. */
+    TRACE_SYSCALL_ENTER,        /* System call ARG[0] entered. */
+    TRACE_SYSCALL_EXIT,         /* System call ARG[0] returns ARG[1]. */
+    TRACE_TYPE_CNT
+  };
+
+/* An event.  32 bytes. */
+struct trace_event
+  {
+    uint64_t tsc;               /* TSC when the event happened. */
+    uint32_t type;              /* A TRACE_* value. */
+    int32_t tid;                /* Running thread. */
+    uint32_t arg[4];            /* Arguments, depending on TYPE. */
+  };
+
+/* Start of a trace file.  As big as an event. */
+struct trace_header
+  {
+    char magic[8];              /* TRACE_MAGIC, not null-terminated. */
+    uint32_t version;           /* TRACE_VERSION. */
+    uint32_t event_cnt;         /* Number of events that follow. */
+    uint64_t tsc_hz;            /* TSC frequency. */
+    uint32_t lost_cnt;          /* Events overwritten. */
+    uint32_t reserved;
+  };
+
+#define TRACE_MAGIC "PINTRACE"
+#define TRACE_VERSION 1
+
+/* Whether to trace, set by -trace. */
+extern bool trace_enabled;
+
+void trace_init (void);
+void trace_event (enum trace_type, uint32_t, uint32_t, uint32_t);
+void trace_thread_name (int tid, const char *name);
+void trace_dump (void);
+
+#endif /* threads/trace.h */
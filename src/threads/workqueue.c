@@ -0,0 +1,188 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stddef.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Queue of the work that comes with the kernel, whose worker
+   runs at the highest priority, like a bottom half would. */
+static struct workqueue system_workqueue;
+
+static void worker (void *wq_);
+static struct work *take_all (struct workqueue *);
+static bool compare_and_swap (struct work *volatile *,
+                              struct work *old, struct work *new);
+
+/* Initializes W as a work item that calls FUNC with AUX, at
+   PRIORITY among the items of its queue. */
+void
+work_init (struct work *w, work_func *func, void *aux, int priority)
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+  ASSERT (priority >= PRI_MIN && priority <= PRI_MAX);
+
+  w->next = NULL;
+  w->func = func;
+  w->aux = aux;
+  w->priority = priority;
+  w->pending = 0;
+}
+
+/* Initializes WQ and creates its worker thread, named NAME, at
+   PRIORITY.  Work may be queued on WQ right away, although it
+   does not run before the worker does. */
+void
+workqueue_create (struct workqueue *wq, const char *name, int priority)
+{
+  ASSERT (wq != NULL);
+  ASSERT (!intr_context ());
+
+  wq->stack = NULL;
+  plist_init (&wq->items);
+  wq->worker = NULL;
+  wq->idle = false;
+  thread_create (name, priority, worker, wq);
+}
+
+/* Queues W on WQ.  Returns false, and does nothing, if W is
+   already queued and has not started to run yet.  The item's
+   function may queue it again.
+
+   May be called from an interrupt handler, and from the
+   scheduler.  It never blocks and never yields the CPU: only in
+   an interrupt handler does it ask to yield on return from the
+   interrupt, if the worker it woke up should preempt the
+   interrupted thread. */
+bool
+workqueue_queue (struct workqueue *wq, struct work *w)
+{
+  struct work *old;
+  int was_pending = 1;
+
+  ASSERT (wq != NULL);
+  ASSERT (w != NULL);
+
+  asm volatile ("xchgl %0, %1"
+                : "+r" (was_pending), "+m" (w->pending) : : "memory");
+  if (was_pending)
+    return false;
+
+  do
+    {
+      old = wq->stack;
+      w->next = old;
+    }
+  while (!compare_and_swap (&wq->stack, old, w));
+
+  /* The worker only goes idle once it has found the stack empty,
+     so there is no need to look unless it was. */
+  if (old == NULL)
+    {
+      enum intr_level old_level = intr_disable ();
+      if (wq->idle)
+        {
+          wq->idle = false;
+          thread_unblock (wq->worker);
+          if (intr_context ())
+            fu_necessary_to_yield ();
+        }
+      intr_set_level (old_level);
+    }
+  return true;
+}
+
+/* Creates the system workqueue.  Called by thread_start(), once
+   threads can be created. */
+void
+workqueue_init (void)
+{
+  workqueue_create (&system_workqueue, "workqueue", PRI_MAX);
+}
+
+/* Queues W on the system workqueue.  Returns false if W was
+   already pending. */
+bool
+work_queue (struct work *w)
+{
+  return workqueue_queue (&system_workqueue, w);
+}
+
+/* Worker thread of the workqueue WQ_.  Runs the queued items
+   one at a time, the highest priority first, and blocks while
+   there are none.  New items are picked up before each item
+   runs, so an urgent one does not wait behind a long batch. */
+static void
+worker (void *wq_)
+{
+  struct workqueue *wq = wq_;
+
+  wq->worker = thread_current ();
+  for (;;)
+    {
+      struct work *w, *next, *oldest = NULL;
+      work_func *func;
+      void *aux;
+
+      /* The stack is newest first: reverse it, so that items of
+         the same priority run in the order they were queued. */
+      for (w = take_all (wq); w != NULL; w = next)
+        {
+          next = w->next;
+          w->next = oldest;
+          oldest = w;
+        }
+      for (w = oldest; w != NULL; w = w->next)
+        plist_push (&wq->items, &w->elem, w->priority);
+
+      if (plist_empty (&wq->items))
+        {
+          /* Interrupts stay off until we block, so that an item
+             queued in between cannot miss waking us up. */
+          enum intr_level old_level = intr_disable ();
+          if (wq->stack == NULL)
+            {
+              wq->idle = true;
+              thread_block ();
+            }
+          intr_set_level (old_level);
+          continue;
+        }
+
+      /* Once W is no longer pending its owner may queue it again
+         or reuse it, so read it before. */
+      w = list_entry (plist_pop_max (&wq->items), struct work, elem);
+      func = w->func;
+      aux = w->aux;
+      barrier ();
+      w->pending = 0;
+      func (aux);
+    }
+}
+
+/* Empties the stack of WQ and returns the items it held, newest
+   first. */
+static struct work *
+take_all (struct workqueue *wq)
+{
+  struct work *w = NULL;
+
+  asm volatile ("xchgl %0, %1"
+                : "+r" (w), "+m" (wq->stack) : : "memory");
+  return w;
+}
+
+/* Atomically replaces *P by NEW if it is OLD.  Returns true if
+   it was replaced. */
+static bool
+compare_and_swap (struct work *volatile *p, struct work *old,
+                  struct work *new)
+{
+  struct work *prev;
+
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "=a" (prev), "+m" (*p)
+                : "r" (new), "0" (old)
+                : "memory");
+  return prev == old;
+}
@@ -0,0 +1,54 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <plist.h>
+#include <stdbool.h>
+
+/* Deferred work.
+
+   A work item is a function to be run later in a kernel thread,
+   the worker of the workqueue it is queued on.  Interrupt
+   handlers queue work so that whatever may block or take long
+   runs with interrupts on, outside of the handler.  The
+   scheduler may queue work as well.
+
+   Queuing never blocks or takes a lock: items are pushed on a
+   stack with an atomic compare-and-swap, which the worker empties
+   in one go.  The worker runs the items it took in order of
+   their priority, and in the order they were queued among items
+   of equal priority. */
+
+/* Function run for a work item, given auxiliary data AUX. */
+typedef void work_func (void *aux);
+
+/* A work item. */
+struct work
+  {
+    struct work *next;          /* Next older item on the stack. */
+    struct list_elem elem;      /* Element in the worker's queue. */
+    work_func *func;            /* Function to run. */
+    void *aux;                  /* Auxiliary data for FUNC. */
+    int priority;               /* PRI_MIN...PRI_MAX, higher runs first. */
+    volatile int pending;       /* Queued and not started yet? */
+  };
+
+/* A workqueue and its worker thread. */
+struct workqueue
+  {
+    struct work *volatile stack; /* Items queued since the worker last
+                                    looked, newest first. */
+    struct plist items;         /* Items taken by the worker, by priority. */
+    struct thread *worker;      /* Worker thread, once it runs. */
+    bool idle;                  /* Worker blocked waiting for work? */
+  };
+
+void work_init (struct work *, work_func *, void *aux, int priority);
+
+void workqueue_create (struct workqueue *, const char *name, int priority);
+bool workqueue_queue (struct workqueue *, struct work *);
+
+void workqueue_init (void);
+bool work_queue (struct work *);
+
+#endif /* threads/workqueue.h */
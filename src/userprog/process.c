@@ -392,6 +392,11 @@ load (const char *file_name, void (**eip) (void), void **esp)
       goto done; 
     }
 
+  /* Keep the executable from changing while it is loaded.  Once
+     this returns, writes in progress have finished and new ones
+     write nothing, until file_close() allows them again. */
+  file_deny_write (file);
+
   /* Read and verify executable header. */
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
       || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
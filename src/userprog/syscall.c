@@ -4,11 +4,14 @@
 #include "filesys/file.h"
 #include "userprog/syscall.h"
 #include "userprog/process.h"
+#include "userprog/pagedir.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
+#include <rusage.h>
 #include <stdio.h>
 #include <syscall-nr.h>
 #include <debug.h>
@@ -19,10 +22,9 @@
 // In pintos every process only has one thread can be treated the same
 typedef tid_t pid_t;
 typedef tid_t fid_t;
-// lock for the file system
-static struct lock lo_file_system;
 // global access to stack pointer to make function declarations easier
-static void* esp;
+// (a pointer to 32-bit words, so that esp + 1 is the first argument)
+static uint32_t* esp;
 // Struct so threads can keep track of open files
 static struct myfile
 {
@@ -30,6 +32,8 @@ static struct myfile
   struct file *file;                 
   struct list_elem elem;
 };
+// cache of the open file records of all processes
+static struct kmem_cache myfile_cache;
 
 static void syscall_handler(struct intr_frame *);
 /* Functions for individual system calls */
@@ -46,6 +50,7 @@ static int read(int fd, void *buffer, unsigned size);
 static int write(int fd, const void *buffer, unsigned size);
 static void seek(int fd, unsigned position);
 static unsigned tell(int fd);
+static void getrusage(struct rusage *usage);
 
 /* Function for reading data at specified *uaddr */
 static int get_user (const uint8_t *uaddr);
@@ -53,6 +58,8 @@ static int get_user (const uint8_t *uaddr);
 // static bool put_user (uint8_t *udst, uint8_t byte);
 /* Function for String verification */
 static void valid_string(const char* str);
+/* Function to verify a user buffer is mapped user memory */
+static void valid_buffer(const void *buffer, unsigned size);
 /* Function to verify user address pointers */
 static void valid_args_pointers();
 //returnes a new file descriptor
@@ -64,8 +71,7 @@ void
 syscall_init (void) 
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
-  // initilize lock used for the file system
-  lock_init(&lo_file_system);
+  kmem_cache_create (&myfile_cache, "myfile", sizeof (struct myfile), NULL);
 }
 
 static void
@@ -75,6 +81,7 @@ syscall_handler (struct intr_frame *f)
   /* Checks the user address pointer is valid */
   valid_args_pointers();
   uint32_t syscall = *(uint32_t*)esp;
+  trace_event(TRACE_SYSCALL_ENTER, syscall, 0, 0);
   /* SYSTEM CALLS Implementation */
   switch(syscall)
   {
@@ -164,8 +171,15 @@ syscall_handler (struct intr_frame *f)
       f->eax = tell(fd);
       break;
     }
+    case SYS_GETRUSAGE:
+    {
+      struct rusage *usage = *(struct rusage**)(esp + 1);
+      getrusage(usage);
+      break;
+    }
     default: exit(-1);
   }
+  trace_event(TRACE_SYSCALL_EXIT, syscall, f->eax, 0);
 }
 
 //==========================================================================//
@@ -180,9 +194,6 @@ static void halt (void)
 }
 static void exit (int status)
 {
-  if(lock_held_by_current_thread(&lo_file_system))
-    lock_release(&lo_file_system);
- 
   struct list* files = &thread_current()->files; 
   while (!list_empty(files))
   {
@@ -194,9 +205,7 @@ static void exit (int status)
 static pid_t exec (const char *cmd_line)
 {
   valid_string(cmd_line);
-  lock_acquire(&lo_file_system);
   pid_t ret = process_execute(cmd_line);
-  lock_release(&lo_file_system);
   return ret;
 }
 static int wait (pid_t pid)
@@ -207,18 +216,14 @@ static bool create (const char *file, unsigned initial_size)
 {
   bool ret;
   valid_string(file);
-  lock_acquire(&lo_file_system);
   ret = filesys_create(file, initial_size);
-  lock_release(&lo_file_system);
   return ret;
 }
 static bool remove (const char *file)
 {
   bool ret;
   valid_string(file);
-  lock_acquire(&lo_file_system);
   ret = filesys_remove(file);
-  lock_release(&lo_file_system);
   return ret;
 }
 static int open (const char *file)
@@ -227,12 +232,10 @@ static int open (const char *file)
   struct myfile* myf;
 
   valid_string(file);
-  lock_acquire(&lo_file_system);
-  
   f = filesys_open(file);
   if(!f) 
     return -1;
-  myf = malloc(sizeof(struct myfile));
+  myf = kmem_cache_alloc(&myfile_cache);
   if(!myf)
   {
     file_close(f);
@@ -242,27 +245,21 @@ static int open (const char *file)
   myf->file = f;
   list_push_front(&thread_current()->files, &myf->elem);
   
-  lock_release(&lo_file_system);
   return myf->fid;
 }
 static void close(int fd)
 {
-  lock_acquire(&lo_file_system);
   //extracts file from the current process's list
   struct file *f = get_file(fd);
   if(!f)
-  {
-    lock_release(&lo_file_system);
     exit(-1);
-  }
 
   //searches for the list entry corresponding to fd
   struct list_elem* el = &(get_indexed_file(fd)->elem);
   //we know from the above that the file_index is referenced in the list
   struct myfile* f_to_be_closed = list_entry(el, struct myfile, elem);
   list_remove(el);
-  free(f_to_be_closed);
-  lock_release(&lo_file_system);
+  kmem_cache_free(&myfile_cache, f_to_be_closed);
 }
 static int filesize (int fd)
 {
@@ -281,9 +278,7 @@ static int filesize (int fd)
 
   if(f->fid != fd)
     return -1;
-  lock_acquire(&lo_file_system);
   size = file_length(f->file);
-  lock_release(&lo_file_system);
 
   return size;
 }
@@ -306,18 +301,13 @@ static int read(int fd, void *buffer, unsigned size)
     return size;
   }
 
-  lock_acquire(&lo_file_system);
   //extracts file from the current process's list
   struct file *f = get_file(fd);
   if(!f)
-  {
-    lock_release(&lo_file_system);
     exit(-1);
-  }
 
   //counts characters read
   int i_total_chars_read = file_read(f, buffer, size);
-  lock_release(&lo_file_system);
 
   return i_total_chars_read;
 }
@@ -332,14 +322,10 @@ static int write(int fd, const void *buffer, unsigned size)
     return size;
   }
 
-  lock_acquire(&lo_file_system);
   //extracts file from the current process's list
   struct file *f = get_file(fd);
   if(!f)
-  {
-    lock_release(&lo_file_system);
     exit(-1);
-  }
 
   //counts characters written
   int i_total_chars_written = 0;
@@ -359,34 +345,32 @@ static int write(int fd, const void *buffer, unsigned size)
     }
   } while(!b_wrote_all);
 
-  lock_release(&lo_file_system);
   return i_total_chars_written;
 }
 static void seek(int fd, unsigned position)
 {
-  lock_acquire(&lo_file_system);
   //extracts file from the current process's list
   struct file *f = get_file(fd);
   if(!f)
-    lock_release(&lo_file_system);
+    exit(-1);
   //calls the file handling source
   file_seek(f, position);
-  lock_release(&lo_file_system);
 }
 static unsigned tell(int fd)
 {
-  lock_acquire(&lo_file_system);
   //extracts file from the current process's list
   struct file *f = get_file(fd);
   if(!f)
-  {
-    lock_release(&lo_file_system);
     exit(-1);
-  }
-  lock_release(&lo_file_system);
   //calls the file handling source
   return (int)file_tell(f);
 }
+static void getrusage(struct rusage *usage)
+{
+  //the kernel writes the accounting straight into the user's buffer
+  valid_buffer(usage, sizeof *usage);
+  thread_get_rusage(usage);
+}
 
 //==========================================================================//
 //==========================================================================//
@@ -426,12 +410,29 @@ static void valid_string(const char* str)
       exit(-1);
   }
 }
+/* Assures the SIZE bytes at BUFFER are mapped user memory.
+   Kills the process if not. */
+static void valid_buffer(const void *buffer, unsigned size)
+{
+  const uint8_t *start = buffer;
+  const uint8_t *end = start + size;
+  const uint8_t *page;
+
+  if(start == NULL || end <= start || !is_user_vaddr(end - 1))
+    exit(-1);
+  for(page = pg_round_down(start); page < end; page += PGSIZE)
+  {
+    if(pagedir_get_page(thread_current()->pagedir, page) == NULL)
+      exit(-1);
+  }
+}
 /* Assures user address pointer + offset is in user space.
    Cleans up resources if not and kills process. */
 
 static void valid_args_pointers()
 {
-  if((*(int*)esp >= *(int*)PHYS_BASE || get_user(esp) == -1) && 
+  if((*(int*)esp >= *(int*)PHYS_BASE ||
+      get_user((const uint8_t *) esp) == -1) && 
      (*(int*)(esp + 3) >= *(int*)PHYS_BASE))
     exit(-1);
 }
@@ -440,7 +441,11 @@ static void valid_args_pointers()
 static unsigned generate_file_descriptor(void)
 {
   static unsigned stat_u_file_index = FILE_DESCRIPTOR_INDEX_BASE;
-  return ++stat_u_file_index;
+  //all processes draw from the same counter
+  enum intr_level old_level = intr_disable();
+  unsigned u_fd = ++stat_u_file_index;
+  intr_set_level(old_level);
+  return u_fd;
 }
 
 //extracts a file from a file_index structure, given a file descriptor
@@ -0,0 +1,202 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../threads/trace.h"
+
+/* Converts the kernel event trace saved by `pintos --trace=FILE'
+   (see threads/trace.h) into a timeline, one event per line. */
+
+/* Size of a record in the trace file, header or event. */
+#define RECORD_SIZE 32
+
+/* Longest thread name kept in the trace, plus a null. */
+#define NAME_SIZE 13
+
+/* Names of threads, indexed by tid. */
+static char (*names)[NAME_SIZE];
+static size_t name_cnt;
+
+static const char *block_types[] =
+  {"kernel", "filesys", "scratch", "swap", "raw", "foreign"};
+
+static const char *syscalls[] =
+  {"halt", "exit", "exec", "wait", "create", "remove", "open", "filesize",
+   "read", "write", "seek", "tell", "close", "mmap", "munmap", "chdir",
+   "mkdir", "readdir", "isdir", "inumber", "getrusage"};
+
+/* TSC frequency, or 0 if the kernel did not know it. */
+static double tsc_hz;
+
+static uint32_t
+get32 (const unsigned char *p)
+{
+  return p[0] | (p[1] << 8) | ((uint32_t) p[2] << 16)
+         | ((uint32_t) p[3] << 24);
+}
+
+static uint64_t
+get64 (const unsigned char *p)
+{
+  return get32 (p) | ((uint64_t) get32 (p + 4) << 32);
+}
+
+/* Returns the name of thread TID, or "?" if it is unknown. */
+static const char *
+thread_name (int32_t tid)
+{
+  return tid >= 0 && (size_t) tid < name_cnt && names[tid][0] != '\0'
+         ? names[tid] : "?";
+}
+
+/* Records that thread TID is named NAME. */
+static void
+set_thread_name (int32_t tid, const char *name)
+{
+  if (tid < 0)
+    return;
+  if ((size_t) tid >= name_cnt)
+    {
+      size_t new_cnt = tid * 2 + 16;
+      names = realloc (names, new_cnt * sizeof *names);
+      if (names == NULL)
+        {
+          fprintf (stderr, "trace-timeline: out of memory\n");
+          exit (EXIT_FAILURE);
+        }
+      memset (names + name_cnt, 0, (new_cnt - name_cnt) * sizeof *names);
+      name_cnt = new_cnt;
+    }
+  strncpy (names[tid], name, NAME_SIZE - 1);
+}
+
+/* Returns CYCLES of the TSC in microseconds, or as is if the
+   frequency is unknown. */
+static double
+cycles_to_us (uint64_t cycles)
+{
+  return tsc_hz > 0 ? cycles * 1e6 / tsc_hz : cycles;
+}
+
+/* Prints what the event of TYPE with arguments ARG did. */
+static void
+print_event (uint32_t type, const unsigned char *arg)
+{
+  uint32_t a0 = get32 (arg), a1 = get32 (arg + 4), a2 = get32 (arg + 8);
+  char name[NAME_SIZE];
+
+  switch (type)
+    {
+    case TRACE_THREAD_NAME:
+      memcpy (name, arg + 4, NAME_SIZE - 1);
+      name[NAME_SIZE - 1] = '\0';
+      set_thread_name (a0, name);
+      printf ("thread %"PRIu32" is named \"%s\"", a0, name);
+      break;
+    case TRACE_SCHEDULE:
+      printf ("switch to %"PRIu32" (%s)", a0, thread_name (a0));
+      break;
+    case TRACE_BLOCK:
+      printf ("block");
+      break;
+    case TRACE_UNBLOCK:
+      printf ("unblock %"PRIu32" (%s)", a0, thread_name (a0));
+      break;
+    case TRACE_LOCK_ACQUIRE:
+      if (a1 != 0)
+        printf ("acquire lock %#"PRIx32" after waiting %.3f us",
+                a0, cycles_to_us (a1));
+      else
+        printf ("acquire lock %#"PRIx32, a0);
+      break;
+    case TRACE_BLOCK_READ:
+    case TRACE_BLOCK_WRITE:
+      printf ("%s sector %"PRIu32" of %s device in %.3f us",
+              type == TRACE_BLOCK_READ ? "read" : "write", a0,
+              a1 < sizeof block_types / sizeof *block_types
+              ? block_types[a1] : "?", cycles_to_us (a2));
+      break;
+    case TRACE_SYSCALL_ENTER:
+    case TRACE_SYSCALL_EXIT:
+      printf ("%s %s", type == TRACE_SYSCALL_ENTER ? "enter" : "exit",
+              a0 < sizeof syscalls / sizeof *syscalls ? syscalls[a0] : "?");
+      if (type == TRACE_SYSCALL_EXIT)
+        printf (" = %"PRId32, (int32_t) a1);
+      break;
+    default:
+      printf ("unknown event %"PRIu32, type);
+      break;
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  unsigned char record[RECORD_SIZE];
+  uint32_t event_cnt, lost_cnt, i;
+  uint64_t first_tsc = 0;
+  FILE *file;
+
+  if (argc != 2)
+    {
+      fprintf (stderr,
+               "trace-timeline: prints a kernel event trace as a timeline\n"
+               "usage: %s TRACE\n"
+               "  where TRACE was saved by `pintos --trace=TRACE'\n",
+               argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  file = fopen (argv[1], "rb");
+  if (file == NULL)
+    {
+      fprintf (stderr, "%s: open: %s\n", argv[1], strerror (errno));
+      return EXIT_FAILURE;
+    }
+  if (fread (record, RECORD_SIZE, 1, file) != 1
+      || memcmp (record, TRACE_MAGIC, 8)
+      || get32 (record + 8) != TRACE_VERSION)
+    {
+      fprintf (stderr, "%s: not a version %d trace\n",
+               argv[1], TRACE_VERSION);
+      return EXIT_FAILURE;
+    }
+  event_cnt = get32 (record + 12);
+  tsc_hz = get64 (record + 16);
+  lost_cnt = get32 (record + 24);
+
+  printf ("%"PRIu32" events, %"PRIu32" earlier ones lost", event_cnt,
+          lost_cnt);
+  if (tsc_hz > 0)
+    printf (", times in us.\n");
+  else
+    printf (", times in TSC cycles.\n");
+  printf ("%14s %5s %-12s %s\n", "time", "tid", "thread", "event");
+
+  for (i = 0; i < event_cnt; i++)
+    {
+      uint64_t tsc;
+      uint32_t type;
+      int32_t tid;
+
+      if (fread (record, RECORD_SIZE, 1, file) != 1)
+        {
+          fprintf (stderr, "%s: trace ends after %"PRIu32" events\n",
+                   argv[1], i);
+          return EXIT_FAILURE;
+        }
+      tsc = get64 (record);
+      type = get32 (record + 8);
+      tid = get32 (record + 12);
+      if (i == 0)
+        first_tsc = tsc;
+
+      printf ("%14.3f %5"PRId32" %-12s ", cycles_to_us (tsc - first_tsc),
+              tid, thread_name (tid));
+      print_event (type, record + 16);
+      printf ("\n");
+    }
+  fclose (file);
+  return EXIT_SUCCESS;
+}